@@ -6,6 +6,27 @@
 #include <cmath>
 #include <chrono>
 #include <string>
+#include <span>
+#include <new>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <limits>
+#include <fstream>
+#include <cstdio>
+#include <sstream>
+#include "MappedFile.h"
+#include "FastWriter.h"
+
+// GCC/Clang 在 x86 上按 CPU 运行时选择 AVX2 内核，其他平台只用标量版本
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COMPLEX_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 using namespace std;
 
 class Complex {
@@ -137,68 +158,2070 @@ std::vector<Complex> rangeSearch(const std::vector<Complex>& vec, double m1, dou
     return result;
 }
 
-void printVector(const std::vector<Complex>& vec, const std::string& title = "") {
-    if (!title.empty()) {
-        std::cout << title << ":" << std::endl;
+// 按 64 字节（缓存行）对齐分配的分配器，供 SIMD 按整块读写
+template<typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    friend bool operator==(const AlignedAllocator&, const AlignedAllocator&) { return true; }
+    friend bool operator!=(const AlignedAllocator&, const AlignedAllocator&) { return false; }
+};
+
+typedef std::vector<double, AlignedAllocator<double>> AlignedDoubles;
+
+// 批量内核：标量版本是参考实现，AVX2 版本结果逐位一致
+// （只用乘、加与正确舍入的 sqrt，不用 FMA）
+void modulusScalar(const double* re, const double* im, double* out, size_t n) {
+    for (size_t k = 0; k < n; k++) out[k] = sqrt(re[k] * re[k] + im[k] * im[k]);
+}
+
+void normSquaredScalar(const double* re, const double* im, double* out, size_t n) {
+    for (size_t k = 0; k < n; k++) out[k] = re[k] * re[k] + im[k] * im[k];
+}
+
+void negateScalar(double* x, size_t n) {
+    for (size_t k = 0; k < n; k++) x[k] = -x[k];
+}
+
+void addScalar(double* re, double* im, const double* re2, const double* im2, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        re[k] += re2[k];
+        im[k] += im2[k];
+    }
+}
+
+// (a+bi)(c+di) = (ac-bd) + (ad+bc)i
+void multiplyScalar(double* re, double* im, const double* re2, const double* im2, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        double a = re[k], b = im[k];
+        re[k] = a * re2[k] - b * im2[k];
+        im[k] = a * im2[k] + b * re2[k];
+    }
+}
+
+// 把模在 [m1, m2] 内的下标追加到 out
+void rangeIndicesScalar(const double* re, const double* im, size_t begin, size_t end,
+                        double m1, double m2, std::vector<size_t>& out) {
+    for (size_t k = begin; k < end; k++) {
+        double mod = sqrt(re[k] * re[k] + im[k] * im[k]);
+        if (mod >= m1 && mod <= m2) out.push_back(k);
+    }
+}
+
+#ifdef COMPLEX_AVX2_DISPATCH
+__attribute__((target("avx2")))
+void modulusAvx2(const double* re, const double* im, double* out, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d a = _mm256_loadu_pd(re + k);
+        __m256d b = _mm256_loadu_pd(im + k);
+        __m256d sum = _mm256_add_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b));
+        _mm256_storeu_pd(out + k, _mm256_sqrt_pd(sum));
+    }
+    modulusScalar(re + k, im + k, out + k, n - k);
+}
+
+__attribute__((target("avx2")))
+void normSquaredAvx2(const double* re, const double* im, double* out, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d a = _mm256_loadu_pd(re + k);
+        __m256d b = _mm256_loadu_pd(im + k);
+        _mm256_storeu_pd(out + k, _mm256_add_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b)));
+    }
+    normSquaredScalar(re + k, im + k, out + k, n - k);
+}
+
+__attribute__((target("avx2")))
+void negateAvx2(double* x, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        _mm256_storeu_pd(x + k, _mm256_xor_pd(_mm256_loadu_pd(x + k), sign));
+    }
+    negateScalar(x + k, n - k);
+}
+
+__attribute__((target("avx2")))
+void addAvx2(double* re, double* im, const double* re2, const double* im2, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        _mm256_storeu_pd(re + k, _mm256_add_pd(_mm256_loadu_pd(re + k), _mm256_loadu_pd(re2 + k)));
+        _mm256_storeu_pd(im + k, _mm256_add_pd(_mm256_loadu_pd(im + k), _mm256_loadu_pd(im2 + k)));
+    }
+    addScalar(re + k, im + k, re2 + k, im2 + k, n - k);
+}
+
+__attribute__((target("avx2")))
+void multiplyAvx2(double* re, double* im, const double* re2, const double* im2, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d a = _mm256_loadu_pd(re + k), b = _mm256_loadu_pd(im + k);
+        __m256d c = _mm256_loadu_pd(re2 + k), d = _mm256_loadu_pd(im2 + k);
+        _mm256_storeu_pd(re + k, _mm256_sub_pd(_mm256_mul_pd(a, c), _mm256_mul_pd(b, d)));
+        _mm256_storeu_pd(im + k, _mm256_add_pd(_mm256_mul_pd(a, d), _mm256_mul_pd(b, c)));
+    }
+    multiplyScalar(re + k, im + k, re2 + k, im2 + k, n - k);
+}
+
+__attribute__((target("avx2")))
+void rangeIndicesAvx2(const double* re, const double* im, size_t begin, size_t end,
+                      double m1, double m2, std::vector<size_t>& out) {
+    const __m256d lo = _mm256_set1_pd(m1);
+    const __m256d hi = _mm256_set1_pd(m2);
+    size_t count = out.size();
+    size_t k = begin;
+    for (; k + 4 <= end; k += 4) {
+        // 预留 4 个位置后无分支写入：命中的下标留下，未命中的被下一个覆盖
+        if (out.size() < count + 4) out.resize(std::max<size_t>(count + 4, out.size() * 2));
+        __m256d a = _mm256_loadu_pd(re + k);
+        __m256d b = _mm256_loadu_pd(im + k);
+        __m256d mod = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b)));
+        __m256d inside = _mm256_and_pd(_mm256_cmp_pd(mod, lo, _CMP_GE_OQ),
+                                       _mm256_cmp_pd(mod, hi, _CMP_LE_OQ));
+        int mask = _mm256_movemask_pd(inside);
+        size_t* slot = out.data();
+        for (int j = 0; j < 4; j++) {
+            slot[count] = k + j;
+            count += (mask >> j) & 1;
+        }
+    }
+    out.resize(count);
+    rangeIndicesScalar(re, im, k, end, m1, m2, out);
+}
+
+bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+// 对两列数据做区间查找，返回模在 [m1, m2] 内的下标
+std::vector<size_t> rangeIndices(const double* re, const double* im, size_t n, double m1, double m2) {
+    std::vector<size_t> result;
+#ifdef COMPLEX_AVX2_DISPATCH
+    if (cpuHasAvx2()) {
+        rangeIndicesAvx2(re, im, 0, n, m1, m2, result);
+        return result;
+    }
+#endif
+    rangeIndicesScalar(re, im, 0, n, m1, m2, result);
+    return result;
+}
+
+// 结构数组（SoA）形式的复数集合：实部、虚部分别连续存放并按缓存行对齐，
+// 批量运算按列扫描，可直接交给 SIMD
+class ComplexArray {
+private:
+    AlignedDoubles re;
+    AlignedDoubles im;
+
+public:
+    ComplexArray() {}
+    explicit ComplexArray(size_t n) : re(n), im(n) {}
+
+    ComplexArray(const std::vector<Complex>& vec) : re(vec.size()), im(vec.size()) {
+        for (size_t i = 0; i < vec.size(); ++i) {
+            re[i] = vec[i].getReal();
+            im[i] = vec[i].getImag();
+        }
+    }
+
+    std::vector<Complex> toVector() const {
+        std::vector<Complex> vec;
+        vec.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            vec.push_back(Complex(re[i], im[i]));
+        }
+        return vec;
+    }
+
+    size_t size() const { return re.size(); }
+    bool empty() const { return re.empty(); }
+
+    void reserve(size_t n) {
+        re.reserve(n);
+        im.reserve(n);
+    }
+
+    void resize(size_t n) {
+        re.resize(n);
+        im.resize(n);
+    }
+
+    void clear() {
+        re.clear();
+        im.clear();
+    }
+
+    void push_back(const Complex& c) {
+        re.push_back(c.getReal());
+        im.push_back(c.getImag());
+    }
+
+    Complex operator[](size_t i) const { return Complex(re[i], im[i]); }
+
+    void set(size_t i, const Complex& c) {
+        re[i] = c.getReal();
+        im[i] = c.getImag();
+    }
+
+    std::span<double> realData() { return re; }
+    std::span<double> imagData() { return im; }
+    std::span<const double> realData() const { return re; }
+    std::span<const double> imagData() const { return im; }
+
+    // 逐元素的模，out 长度须等于 size()
+    void modulus(std::span<double> out) const {
+        if (out.size() != size()) throw std::invalid_argument("modulus: output size mismatch");
+#ifdef COMPLEX_AVX2_DISPATCH
+        if (cpuHasAvx2()) {
+            modulusAvx2(re.data(), im.data(), out.data(), size());
+            return;
+        }
+#endif
+        modulusScalar(re.data(), im.data(), out.data(), size());
+    }
+
+    // 逐元素的模平方，比较大小时可免去 sqrt
+    void normSquared(std::span<double> out) const {
+        if (out.size() != size()) throw std::invalid_argument("normSquared: output size mismatch");
+#ifdef COMPLEX_AVX2_DISPATCH
+        if (cpuHasAvx2()) {
+            normSquaredAvx2(re.data(), im.data(), out.data(), size());
+            return;
+        }
+#endif
+        normSquaredScalar(re.data(), im.data(), out.data(), size());
+    }
+
+    // 原地取共轭
+    void conjugate() {
+#ifdef COMPLEX_AVX2_DISPATCH
+        if (cpuHasAvx2()) {
+            negateAvx2(im.data(), size());
+            return;
+        }
+#endif
+        negateScalar(im.data(), size());
+    }
+
+    // 逐元素相加
+    ComplexArray& operator+=(const ComplexArray& other) {
+        if (other.size() != size()) throw std::invalid_argument("operator+=: size mismatch");
+#ifdef COMPLEX_AVX2_DISPATCH
+        if (cpuHasAvx2()) {
+            addAvx2(re.data(), im.data(), other.re.data(), other.im.data(), size());
+            return *this;
+        }
+#endif
+        addScalar(re.data(), im.data(), other.re.data(), other.im.data(), size());
+        return *this;
+    }
+
+    // 逐元素相乘
+    ComplexArray& operator*=(const ComplexArray& other) {
+        if (other.size() != size()) throw std::invalid_argument("operator*=: size mismatch");
+#ifdef COMPLEX_AVX2_DISPATCH
+        if (cpuHasAvx2()) {
+            multiplyAvx2(re.data(), im.data(), other.re.data(), other.im.data(), size());
+            return *this;
+        }
+#endif
+        multiplyScalar(re.data(), im.data(), other.re.data(), other.im.data(), size());
+        return *this;
+    }
+
+    // 模在 [m1, m2] 内的元素下标，按原顺序
+    std::vector<size_t> rangeIndices(double m1, double m2) const {
+        return ::rangeIndices(re.data(), im.data(), size(), m1, m2);
+    }
+};
+
+// 区间查找（结构数组版本），结果与 vector 版本顺序一致
+ComplexArray rangeSearch(const ComplexArray& arr, double m1, double m2) {
+    std::vector<size_t> indices = arr.rangeIndices(m1, m2);
+    ComplexArray result;
+    result.reserve(indices.size());
+    for (size_t i : indices) {
+        result.push_back(arr[i]);
+    }
+    return result;
+}
+
+// 排序用的带键元素：模只在装饰时计算一次
+struct KeyedComplex {
+    double mod;
+    double real;
+    double imag;
+};
+
+// 与 Complex::operator< 逐条对应，模取自缓存的键
+inline bool keyedLess(const KeyedComplex& a, const KeyedComplex& b) {
+    if (std::abs(a.mod - b.mod) > 1e-6)
+        return a.mod < b.mod;
+    if (std::abs(a.real - b.real) > 1e-6)
+        return a.real < b.real;
+    return a.imag < b.imag;
+}
+
+// 按模排序：装饰-排序-去装饰，键与临时缓冲区在多次调用间复用。
+// operator< 带 1e-6 容差，不是严格弱序，std::sort 在此不安全；
+// 这里沿用 mergeSort 的划分与合并规则，结果与 mergeSort 逐元素相同，
+// 上层子区间交给多个线程并行排序
+class ComplexSorter {
+private:
+    static const size_t PARALLEL_THRESHOLD = 1 << 15;
+
+    std::vector<KeyedComplex> keys;
+    std::vector<KeyedComplex> scratch;
+
+    // 合并 [left, mid] 与 [mid+1, right]，并列时取右半（与 merge 一致）
+    void mergeRange(size_t left, size_t mid, size_t right) {
+        std::copy(keys.begin() + left, keys.begin() + right + 1, scratch.begin() + left);
+        size_t i = left, j = mid + 1, k = left;
+        while (i <= mid && j <= right) {
+            if (keyedLess(scratch[i], scratch[j])) {
+                keys[k++] = scratch[i++];
+            } else {
+                keys[k++] = scratch[j++];
+            }
+        }
+        while (i <= mid) keys[k++] = scratch[i++];
+        while (j <= right) keys[k++] = scratch[j++];
+    }
+
+    void sortRange(size_t left, size_t right, int depth) {
+        if (left >= right) return;
+        size_t mid = left + (right - left) / 2;
+        if (depth > 0 && right - left >= PARALLEL_THRESHOLD) {
+            std::thread worker([this, left, mid, depth] { sortRange(left, mid, depth - 1); });
+            sortRange(mid + 1, right, depth - 1);
+            worker.join();
+        } else {
+            sortRange(left, mid, 0);
+            sortRange(mid + 1, right, 0);
+        }
+        mergeRange(left, mid, right);
+    }
+
+    void sortKeys(unsigned threads) {
+        if (keys.size() < 2) return;
+        scratch.resize(keys.size());
+        int depth = 0;
+        while ((1u << depth) < threads) depth++;
+        sortRange(0, keys.size() - 1, depth);
+    }
+
+public:
+    void sort(std::vector<Complex>& vec, unsigned threads = std::thread::hardware_concurrency()) {
+        keys.resize(vec.size());
+        for (size_t i = 0; i < vec.size(); ++i) {
+            keys[i] = {vec[i].getModulus(), vec[i].getReal(), vec[i].getImag()};
+        }
+        sortKeys(std::max(1u, threads));
+        for (size_t i = 0; i < vec.size(); ++i) {
+            vec[i] = Complex(keys[i].real, keys[i].imag);
+        }
+    }
+
+    void sort(ComplexArray& arr, unsigned threads = std::thread::hardware_concurrency()) {
+        std::span<double> re = arr.realData(), im = arr.imagData();
+        AlignedDoubles mods(arr.size());
+        arr.modulus(mods);
+        keys.resize(arr.size());
+        for (size_t i = 0; i < arr.size(); ++i) {
+            keys[i] = {mods[i], re[i], im[i]};
+        }
+        sortKeys(std::max(1u, threads));
+        for (size_t i = 0; i < arr.size(); ++i) {
+            re[i] = keys[i].real;
+            im[i] = keys[i].imag;
+        }
+    }
+};
+
+void sortByModulus(std::vector<Complex>& vec) {
+    ComplexSorter sorter;
+    sorter.sort(vec);
+}
+
+// 索引查询结果的顺序：ORDER_INDEX 按索引内部的遍历顺序直接返回，代价 O(log n + k)；
+// ORDER_BY_ID 再按 id 升序排序（多 O(k log k)），与线性扫描的结果顺序一致
+typedef enum { ORDER_INDEX, ORDER_BY_ID } ResultOrder;
+
+// 按模有序的持久索引：元素以调用方给定的 id 标识（由 vector 建立时 id 即下标），
+// 区间查询与精确查找为 O(log n + k)，插入删除为 O(log n)，无需重建
+class ModulusIndex {
+private:
+    // (模, 实部, 虚部, id) 按字典序比较，是严格弱序
+    typedef std::tuple<double, double, double, size_t> Entry;
+
+    std::set<Entry> entries;
+    std::unordered_map<size_t, Entry> byId;
+
+    // |a-b| < 1e-6（实部、虚部各自）时两者模之差不超过 sqrt(2)*1e-6，
+    // 精确查找只需扫描这个模窗口
+    static constexpr double FIND_WINDOW = 1.5e-6;
+
+    static Entry makeEntry(size_t id, const Complex& c) {
+        return Entry(c.getModulus(), c.getReal(), c.getImag(), id);
+    }
+
+    static Complex toComplex(const Entry& e) {
+        return Complex(std::get<1>(e), std::get<2>(e));
+    }
+
+public:
+    ModulusIndex() {}
+    explicit ModulusIndex(const std::vector<Complex>& vec) {
+        for (size_t i = 0; i < vec.size(); ++i) {
+            insert(i, vec[i]);
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+    bool contains(size_t id) const { return byId.count(id) != 0; }
+
+    // 插入新元素；id 已存在时替换其值
+    void insert(size_t id, const Complex& c) {
+        erase(id);
+        Entry e = makeEntry(id, c);
+        entries.insert(e);
+        byId.emplace(id, e);
+    }
+
+    bool erase(size_t id) {
+        auto it = byId.find(id);
+        if (it == byId.end()) return false;
+        entries.erase(it->second);
+        byId.erase(it);
+        return true;
+    }
+
+    // 按模从小到大访问模在 [m1, m2] 内的元素，fn(id, c)
+    template<typename Fn>
+    void visitRange(double m1, double m2, Fn fn) const {
+        const double lowest = -std::numeric_limits<double>::infinity();
+        for (auto it = entries.lower_bound(Entry(m1, lowest, lowest, 0));
+             it != entries.end() && std::get<0>(*it) <= m2; ++it) {
+            fn(std::get<3>(*it), toComplex(*it));
+        }
+    }
+
+    // 模在 [m1, m2] 内的 id；默认按模升序
+    std::vector<size_t> rangeIds(double m1, double m2, ResultOrder order = ORDER_INDEX) const {
+        std::vector<size_t> ids;
+        visitRange(m1, m2, [&](size_t id, const Complex&) { ids.push_back(id); });
+        if (order == ORDER_BY_ID) std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // ORDER_BY_ID 时与线性 rangeSearch 的结果逐项相同
+    std::vector<Complex> rangeSearch(double m1, double m2, ResultOrder order = ORDER_INDEX) const {
+        std::vector<Complex> result;
+        if (order == ORDER_INDEX) {
+            visitRange(m1, m2, [&](size_t, const Complex& c) { result.push_back(c); });
+            return result;
+        }
+        std::vector<size_t> ids = rangeIds(m1, m2, order);
+        result.reserve(ids.size());
+        for (size_t id : ids) {
+            result.push_back(toComplex(byId.at(id)));
+        }
+        return result;
+    }
+
+    // 与 target 在容差内相等的元素中最小的 id，没有时返回 -1，与 findComplex 一致
+    long long find(const Complex& target) const {
+        long long best = -1;
+        double mod = target.getModulus();
+        visitRange(mod - FIND_WINDOW, mod + FIND_WINDOW, [&](size_t id, const Complex& c) {
+            if (c == target && (best < 0 || (long long)id < best)) {
+                best = (long long)id;
+            }
+        });
+        return best;
     }
+};
+
+// 按 flags 原地压缩，保留 keep[i] 非零的元素，顺序不变
+void compactVector(std::vector<Complex>& vec, const std::vector<uint8_t>& keep) {
+    size_t out = 0;
     for (size_t i = 0; i < vec.size(); ++i) {
-        std::cout << vec[i] << " ";
-        if ((i + 1) % 5 == 0 && i != vec.size() - 1)
-            std::cout << std::endl;
+        if (keep[i]) vec[out++] = vec[i];
     }
-    std::cout << std::endl << std::endl;
+    vec.resize(out);
 }
 
-int main() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-10.0, 10.0);
+// 对 [0, n) 分块并行执行 fn(begin, end)，块数不超过 threads
+template<typename Fn>
+void parallelFor(size_t n, unsigned threads, Fn fn) {
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, n / 4096));
+    if (threads <= 1) {
+        fn(size_t(0), n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    size_t chunk = (n + threads - 1) / threads;
+    for (unsigned t = 0; t < threads; ++t) {
+        size_t begin = t * chunk, end = std::min(n, begin + chunk);
+        if (begin < end) workers.emplace_back(fn, begin, end);
+    }
+    for (auto& w : workers) w.join();
+}
 
-    std::vector<Complex> complexVector;
-    int numComplex = 15;
+// 开放寻址的格子表：格子键 -> 格内最后插入的元素下标
+class CellTable {
+private:
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> heads;
+    size_t mask = 0;
+
+    size_t slotOf(uint64_t key) const {
+        return (size_t)((key ^ (key >> 29)) * 0xBF58476D1CE4E5B9ull >> 17) & mask;
+    }
+
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    explicit CellTable(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity *= 2;
+        keys.resize(capacity);
+        heads.assign(capacity, NONE);
+        mask = capacity - 1;
+    }
 
-    std::cout << "生成 " << numComplex << " 随机复数..." << std::endl;
+    // 返回 key 对应的槽位，不存在时占用一个空槽
+    uint32_t& head(uint64_t key) {
+        size_t slot = slotOf(key);
+        while (heads[slot] != NONE && keys[slot] != key) slot = (slot + 1) & mask;
+        keys[slot] = key;
+        return heads[slot];
+    }
 
-    for (int i = 0; i < numComplex; ++i) {
-        double real = dis(gen);
-        double imag = dis(gen);
-        complexVector.push_back(Complex(real, imag));
+    void prefetch(uint64_t key) const {
+#if defined(__GNUC__)
+        size_t slot = slotOf(key);
+        __builtin_prefetch(&keys[slot]);
+        __builtin_prefetch(&heads[slot]);
+#else
+        (void)key;
+#endif
+    }
 
-        if (i % 3 == 0 && i > 0) {
-            complexVector.push_back(complexVector[i - 1]);
+    uint32_t find(uint64_t key) const {
+        for (size_t slot = slotOf(key); heads[slot] != NONE; slot = (slot + 1) & mask) {
+            if (keys[slot] == key) return heads[slot];
         }
+        return NONE;
     }
+};
 
-    printVector(complexVector, "原始随机复数");
+// 真正的去重（网格哈希）：按下标顺序，元素与之前保留下来的某个元素在 1e-6 容差内相等时删除，
+// 保留者的相对顺序不变。operator== 不可传递，不能直接哈希；这里把平面划分为
+// 边长 4e-6 的网格，相等的两点必在相同或相邻格子，只需检查 3x3 邻域中离点不足 1e-6 的格子。
+// 每个格子只记录格内保留下来的元素，它们两两不等，一格至多十几个，
+// 所以每个元素的比较次数有常数上界，重复再多也是期望 O(n)。
+// 格子坐标并行计算；去留取决于之前哪些元素被保留，判定按下标顺序进行
+void uniqueByGrid(std::vector<Complex>& vec, unsigned threads = std::thread::hardware_concurrency()) {
+    constexpr double CELL = 4e-6;
+    const uint32_t NONE = CellTable::NONE;
+    size_t n = vec.size();
+    if (n >= NONE) throw std::length_error("uniqueByGrid: too many elements");
 
-    std::cout << "(1) 基础操作" << std::endl;
+    // 不同格子的键偶尔冲突只会多出候选，真正的判定仍由 operator== 完成
+    auto cellKey = [](int64_t cx, int64_t cy) {
+        return (uint64_t)cx * 0x9E3779B97F4A7C15ull ^ (uint64_t)cy;
+    };
 
-    // 置乱
-    std::shuffle(complexVector.begin(), complexVector.end(), gen);
-    printVector(complexVector, "打乱后的复数");
+    // 格边长是容差的四倍，点离格边不足 1e-6 时才需要查那一侧的邻格
+    // （留出余量吸收舍入误差），平均约 2.3 个格子。
+    // 一个坐标的绝对值超过 2^52 个格子（约 1.8e10）时，相邻 double 之差已大于容差，
+    // 该方向上相等就是完全相同：直接用坐标的位模式当格子编号，不查邻格，也避免整数转换溢出。
+    // 含 inf/NaN 的点与任何点都不相等，一律保留
+    constexpr uint8_t LOWER = 1, UPPER = 2, SKIP = 16;
+    auto axisCell = [](double v, int64_t& cell) -> uint8_t {
+        if (!std::isfinite(v)) return SKIP;
+        double f = v / CELL;
+        if (!(std::fabs(f) < 0x1.0p52)) {
+            uint64_t bits;
+            std::memcpy(&bits, &v, sizeof bits);
+            cell = (int64_t)bits;
+            return 0;
+        }
+        double base = std::floor(f);
+        cell = (int64_t)base;
+        return (f - base < 0.26 ? LOWER : 0) | (f - base > 0.74 ? UPPER : 0);
+    };
+    // sides 的 bit0/bit1 表示要查左/右邻格，bit2/bit3 表示要查下/上邻格，SKIP 表示直接保留
+    std::vector<int64_t> cells(2 * n);
+    std::vector<uint8_t> sides(n);
+    parallelFor(n, std::max(1u, threads), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint8_t sx = axisCell(vec[i].getReal(), cells[2 * i]);
+            uint8_t sy = axisCell(vec[i].getImag(), cells[2 * i + 1]);
+            sides[i] = (sx | sy) & SKIP ? SKIP : sx | sy << 2;
+        }
+    });
+    auto forEachCandidateCell = [&](size_t i, auto fn) {
+        if (sides[i] & SKIP) return;
+        int64_t cx = cells[2 * i], cy = cells[2 * i + 1];
+        uint8_t s = sides[i];
+        for (int dx = (s & 1) ? -1 : 0; dx <= ((s & 2) ? 1 : 0); ++dx) {
+            for (int dy = (s & 4) ? -1 : 0; dy <= ((s & 8) ? 1 : 0); ++dy) {
+                if (!fn(cellKey(cx + dx, cy + dy))) return;
+            }
+        }
+    };
 
-    // 查找
-    if (!complexVector.empty()) {
-        Complex target = complexVector[complexVector.size() / 2];
-        int index = findComplex(complexVector, target); 
-        std::cout << "查找 " << target << ": Index = " << index << std::endl << std::endl;
+    // 表中记录每个格子最后保留的元素，next 把同格的保留者串成链
+    CellTable table(n);
+    std::vector<uint32_t> next(n);
+    std::vector<uint8_t> keep(n, 1);
+    // 提前预取后续元素的候选格子，把随机访存重叠起来
+    const size_t AHEAD = 16;
+    auto prefetch = [&](uint64_t key) {
+        table.prefetch(key);
+        return true;
+    };
+    for (size_t i = 0; i < std::min(n, AHEAD); ++i) forEachCandidateCell(i, prefetch);
+    for (size_t i = 0; i < n; ++i) {
+        if (i + AHEAD < n) forEachCandidateCell(i + AHEAD, prefetch);
+        forEachCandidateCell(i, [&](uint64_t key) {
+            for (uint32_t j = table.find(key); j != NONE; j = next[j]) {
+                if (vec[j] == vec[i]) {
+                    keep[i] = 0;
+                    return false;
+                }
+            }
+            return true;
+        });
+        if (keep[i] && !(sides[i] & SKIP)) {
+            uint32_t& head = table.head(cellKey(cells[2 * i], cells[2 * i + 1]));
+            next[i] = head;
+            head = (uint32_t)i;
+        }
     }
+    compactVector(vec, keep);
+}
 
-    // 插入
-    Complex newComplex(dis(gen), dis(gen));
-    complexVector.insert(complexVector.begin() + 3, newComplex);
-    std::cout << "插入后 " << newComplex << " at index 3" << std::endl;
-    printVector(complexVector);
+// 排序后去重：按 (模, 实部, 虚部) 精确排序（严格弱序，可放心用 std::sort），
+// 再按排序后的顺序删除与更早保留者相等的元素。排序为 O(n log n)；后一步就是对排好序的
+// 序列做网格哈希去重，与同模的点有多少（如都在单位圆上）无关，期望 O(n)。结果按模升序排列
+void uniqueBySort(std::vector<Complex>& vec, unsigned threads = std::thread::hardware_concurrency()) {
+    size_t n = vec.size();
+    std::vector<KeyedComplex> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = {vec[i].getModulus(), vec[i].getReal(), vec[i].getImag()};
+    }
+    auto exactLess = [](const KeyedComplex& a, const KeyedComplex& b) {
+        return std::tie(a.mod, a.real, a.imag) < std::tie(b.mod, b.real, b.imag);
+    };
 
-    // 删除
-    if (complexVector.size() > 5) {
-        complexVector.erase(complexVector.begin() + 2);
-        printVector(complexVector, "删除后元素");
+    // 各段并行排序，再逐层两两合并
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(std::max(1u, threads), n / 4096));
+    size_t chunk = (n + threads - 1) / std::max(1u, threads);
+    {
+        std::vector<std::thread> workers;
+        for (size_t begin = 0; begin < n; begin += chunk) {
+            workers.emplace_back([&, begin] {
+                std::sort(keys.begin() + begin, keys.begin() + std::min(n, begin + chunk), exactLess);
+            });
+        }
+        for (auto& w : workers) w.join();
+    }
+    for (size_t width = chunk; width < n; width *= 2) {
+        std::vector<std::thread> workers;
+        for (size_t begin = 0; begin + width < n; begin += 2 * width) {
+            workers.emplace_back([&, begin] {
+                std::inplace_merge(keys.begin() + begin, keys.begin() + begin + width,
+                                   keys.begin() + std::min(n, begin + 2 * width), exactLess);
+            });
+        }
+        for (auto& w : workers) w.join();
     }
 
-    // 唯一化
-    uniqueVector(complexVector);
-    printVector(complexVector, "唯一化后元素");
+    for (size_t i = 0; i < n; ++i) {
+        vec[i] = Complex(keys[i].real, keys[i].imag);
+    }
+    uniqueByGrid(vec, threads);
+}
+
+// 批量编辑中的一项：位置均指编辑前的原始下标。
+// 插入放在原元素 position 之前（position == size() 表示末尾），同一位置的插入按给出顺序；
+// 删除去掉原元素 position
+struct VectorEdit {
+    size_t position;
+    bool erase;
+    Complex value;
+};
+
+// 一次性应用一批插入/删除，代替逐个 insert/erase 各自移动整个尾部：
+// 先正向压缩删除，再反向展开插入，两遍线性扫描，原地完成
+void applyEdits(std::vector<Complex>& vec, std::vector<VectorEdit> edits) {
+    size_t n = vec.size();
+    for (const VectorEdit& e : edits) {
+        if (e.position > n || (e.erase && e.position == n)) {
+            throw std::out_of_range("applyEdits: position out of range");
+        }
+    }
+    std::stable_sort(edits.begin(), edits.end(), [](const VectorEdit& a, const VectorEdit& b) {
+        return a.position < b.position;
+    });
+
+    // 正向：删除并记录每个插入在压缩后向量中的位置
+    std::vector<size_t> insertAt;
+    std::vector<const Complex*> insertValues;
+    size_t out = 0, read = 0;
+    for (const VectorEdit& e : edits) {
+        while (read < e.position) vec[out++] = vec[read++];
+        if (e.erase) {
+            if (read == e.position) read++;  // 同一元素重复删除只算一次
+        } else {
+            insertAt.push_back(out);
+            insertValues.push_back(&e.value);
+        }
+    }
+    while (read < n) vec[out++] = vec[read++];
+
+    // 反向：从尾部开始把元素挪到最终位置，并填入插入的值
+    size_t compacted = out;
+    size_t total = compacted + insertAt.size();
+    vec.resize(total);
+    size_t write = total;
+    read = compacted;
+    for (size_t k = insertAt.size(); k-- > 0;) {
+        while (read > insertAt[k]) vec[--write] = vec[--read];
+        vec[--write] = *insertValues[k];
+    }
+}
+
+// 分块存储的复数序列：块长保持在 BLOCK/2 到 2*BLOCK 之间（只有一块时可以更短），树状数组记录各块大小，
+// 按位置定位块为 O(log n)，块内插入删除只移动一个块；遍历按块顺序连续访问
+class ComplexBlockList {
+private:
+    static const size_t BLOCK = 1024;
+
+    std::vector<std::vector<Complex>> blocks;
+    std::vector<size_t> tree;  // 树状数组，下标从 1 开始
+    size_t count = 0;
+
+    void rebuildTree() {
+        tree.assign(blocks.size() + 1, 0);
+        for (size_t b = 1; b <= blocks.size(); ++b) {
+            tree[b] += blocks[b - 1].size();
+            size_t parent = b + (b & (0 - b));
+            if (parent <= blocks.size()) tree[parent] += tree[b];
+        }
+    }
+
+    void addToTree(size_t block, long long delta) {
+        for (size_t b = block + 1; b < tree.size(); b += b & (0 - b)) {
+            tree[b] += delta;
+        }
+    }
+
+    // 找到包含位置 pos 的块，pos 改写为块内偏移
+    size_t locate(size_t& pos) const {
+        size_t block = 0;
+        size_t step = 1;
+        while (step * 2 < tree.size()) step *= 2;
+        for (; step > 0; step /= 2) {
+            if (block + step < tree.size() && tree[block + step] <= pos) {
+                block += step;
+                pos -= tree[block];
+            }
+        }
+        return block;
+    }
+
+public:
+    ComplexBlockList() {}
+    explicit ComplexBlockList(const std::vector<Complex>& vec) {
+        for (size_t i = 0; i < vec.size(); i += BLOCK) {
+            blocks.emplace_back(vec.begin() + i, vec.begin() + std::min(vec.size(), i + BLOCK));
+        }
+        count = vec.size();
+        rebuildTree();
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t blockCount() const { return blocks.size(); }
+
+    const Complex& operator[](size_t pos) const {
+        size_t block = locate(pos);
+        return blocks[block][pos];
+    }
+
+    void insert(size_t pos, const Complex& c) {
+        if (pos > count) throw std::out_of_range("ComplexBlockList::insert: position out of range");
+        if (blocks.empty()) {
+            blocks.emplace_back();
+            rebuildTree();
+        }
+        size_t block;
+        if (pos == count) {
+            block = blocks.size() - 1;
+            pos = blocks[block].size();
+        } else {
+            block = locate(pos);
+        }
+        std::vector<Complex>& target = blocks[block];
+        target.insert(target.begin() + pos, c);
+        count++;
+        if (target.size() > 2 * BLOCK) {
+            // 块过大时对半拆分，块数变化后重建树状数组（摊还到每次插入很小）
+            std::vector<Complex> tail(target.begin() + BLOCK, target.end());
+            target.resize(BLOCK);
+            blocks.insert(blocks.begin() + block + 1, std::move(tail));
+            rebuildTree();
+        } else {
+            addToTree(block, 1);
+        }
+    }
+
+    void erase(size_t pos) {
+        if (pos >= count) throw std::out_of_range("ComplexBlockList::erase: position out of range");
+        size_t block = locate(pos);
+        std::vector<Complex>& target = blocks[block];
+        target.erase(target.begin() + pos);
+        count--;
+        if (target.size() < BLOCK / 2 && blocks.size() > 1) {
+            // 块过小时与相邻块合并，合并后过大则在两块间平分；两种情况下新块都接近 BLOCK 以上，
+            // 要再删除约 BLOCK/2 次才会再次触发，重建树状数组的代价摊还后很小
+            size_t left = block + 1 < blocks.size() ? block : block - 1;
+            std::vector<Complex>& a = blocks[left];
+            std::vector<Complex>& b = blocks[left + 1];
+            size_t total = a.size() + b.size();
+            if (total <= 2 * BLOCK) {
+                a.insert(a.end(), b.begin(), b.end());
+                blocks.erase(blocks.begin() + left + 1);
+            } else if (a.size() < total / 2) {
+                size_t moved = total / 2 - a.size();
+                a.insert(a.end(), b.begin(), b.begin() + moved);
+                b.erase(b.begin(), b.begin() + moved);
+            } else {
+                size_t moved = a.size() - total / 2;
+                b.insert(b.begin(), a.end() - moved, a.end());
+                a.resize(total / 2);
+            }
+            rebuildTree();
+        } else if (target.empty()) {
+            blocks.clear();
+            rebuildTree();
+        } else {
+            addToTree(block, -1);
+        }
+    }
+
+    template<typename Fn>
+    void forEach(Fn fn) const {
+        for (const auto& block : blocks) {
+            for (const Complex& c : block) fn(c);
+        }
+    }
+
+    std::vector<Complex> toVector() const {
+        std::vector<Complex> vec;
+        vec.reserve(count);
+        forEach([&](const Complex& c) { vec.push_back(c); });
+        return vec;
+    }
+};
+
+// 列式二进制文件格式（小端，与本机 double 布局相同）：
+//   64 字节文件头 | 实部列 | 虚部列，两列各自按 64 字节对齐
+// 文件头的 flags 第 0 位表示数据已按模排序
+const char COMPLEX_FILE_MAGIC[8] = {'C', 'P', 'L', 'X', 'C', 'O', 'L', '1'};
+const uint32_t COMPLEX_FILE_VERSION = 1;
+const uint32_t COMPLEX_FILE_SORTED = 1;
+const size_t COMPLEX_FILE_ALIGN = 64;
+
+struct ComplexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;
+    uint64_t realOffset;  // 实部列相对文件开头的字节偏移
+    uint64_t imagOffset;
+    char reserved[24];
+};
+static_assert(sizeof(ComplexFileHeader) == 64, "ComplexFileHeader must be 64 bytes");
+
+void saveComplexFile(const std::string& path, std::span<const double> re, std::span<const double> im,
+                     bool sortedByModulus = false) {
+    if (re.size() != im.size()) throw std::invalid_argument("saveComplexFile: column size mismatch");
+    auto alignUp = [](uint64_t x) { return (x + COMPLEX_FILE_ALIGN - 1) / COMPLEX_FILE_ALIGN * COMPLEX_FILE_ALIGN; };
+
+    ComplexFileHeader header = {};
+    std::memcpy(header.magic, COMPLEX_FILE_MAGIC, sizeof(header.magic));
+    header.version = COMPLEX_FILE_VERSION;
+    header.flags = sortedByModulus ? COMPLEX_FILE_SORTED : 0;
+    header.count = re.size();
+    header.realOffset = alignUp(sizeof(header));
+    header.imagOffset = alignUp(header.realOffset + re.size_bytes());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("无法写入文件: " + path);
+    static const char padding[COMPLEX_FILE_ALIGN] = {};
+    out.write((const char*)&header, sizeof(header));
+    out.write(padding, header.realOffset - sizeof(header));
+    out.write((const char*)re.data(), re.size_bytes());
+    out.write(padding, header.imagOffset - header.realOffset - re.size_bytes());
+    out.write((const char*)im.data(), im.size_bytes());
+    if (!out) throw std::runtime_error("写入文件失败: " + path);
+}
+
+void saveComplexFile(const std::string& path, const ComplexArray& arr, bool sortedByModulus = false) {
+    saveComplexFile(path, arr.realData(), arr.imagData(), sortedByModulus);
+}
+
+void saveComplexFile(const std::string& path, const std::vector<Complex>& vec, bool sortedByModulus = false) {
+    saveComplexFile(path, ComplexArray(vec), sortedByModulus);
+}
+
+// 通过内存映射零拷贝读取的列式文件：打开只校验文件头，两列直接指向映射内存
+class ComplexFileView {
+private:
+    MappedFile file;
+    ComplexFileHeader header = {};
+    const double* re = nullptr;
+    const double* im = nullptr;
+
+public:
+    explicit ComplexFileView(const std::string& path) : file(path) {
+        if (file.size() < sizeof(header)) throw std::runtime_error("文件过短: " + path);
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, COMPLEX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("不是复数列式文件: " + path);
+        }
+        if (header.version != COMPLEX_FILE_VERSION) {
+            throw std::runtime_error("不支持的文件版本: " + path);
+        }
+        uint64_t columnBytes = header.count * sizeof(double);
+        if (header.count > file.size() / sizeof(double) ||
+            header.realOffset % alignof(double) != 0 || header.imagOffset % alignof(double) != 0 ||
+            header.realOffset > file.size() || file.size() - header.realOffset < columnBytes ||
+            header.imagOffset > file.size() || file.size() - header.imagOffset < columnBytes) {
+            throw std::runtime_error("文件头与文件大小不符: " + path);
+        }
+        re = (const double*)(file.data() + header.realOffset);
+        im = (const double*)(file.data() + header.imagOffset);
+    }
+
+    size_t size() const { return header.count; }
+    bool sortedByModulus() const { return header.flags & COMPLEX_FILE_SORTED; }
+
+    std::span<const double> realData() const { return {re, size()}; }
+    std::span<const double> imagData() const { return {im, size()}; }
+
+    Complex operator[](size_t i) const { return Complex(re[i], im[i]); }
+
+    // 直接在映射内存上做区间查找
+    std::vector<size_t> rangeIndices(double m1, double m2) const {
+        file.adviseSequential(header.realOffset, header.count * sizeof(double));
+        file.adviseSequential(header.imagOffset, header.count * sizeof(double));
+        return ::rangeIndices(re, im, size(), m1, m2);
+    }
+
+    // 复制到内存中的 ComplexArray（例如需要原地排序时）
+    ComplexArray toArray() const {
+        ComplexArray arr(size());
+        std::copy(re, re + size(), arr.realData().begin());
+        std::copy(im, im + size(), arr.imagData().begin());
+        return arr;
+    }
+};
+
+// SplitMix64 的混合函数：相邻计数值也能得到互不相关的 64 位输出
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// 基于计数器的随机复数生成器：第 i 个元素只由 (seed, i) 决定，
+// 各线程可以独立填充不相交的区间，结果与线程数无关、可复现。
+// duplicateRate 为元素重复前一元素的概率：连续的重复段都复制段首元素的值
+class ComplexGenerator {
+private:
+    uint64_t seed;
+    double low;
+    double high;
+    uint64_t duplicateThreshold;  // 判定值低于此阈值即为重复
+
+    // 三路独立的流：实部、虚部、是否重复
+    uint64_t bits(size_t i, uint64_t stream) const {
+        return splitMix64(seed ^ splitMix64(i * 3 + stream));
+    }
+
+    double uniform(size_t i, uint64_t stream) const {
+        return low + (bits(i, stream) >> 11) * 0x1.0p-53 * (high - low);
+    }
+
+    bool isDuplicate(size_t i) const {
+        return i > 0 && bits(i, 2) < duplicateThreshold;
+    }
+
+public:
+    ComplexGenerator(uint64_t seed, double low = -10.0, double high = 10.0, double duplicateRate = 0.0)
+        : seed(seed), low(low), high(high) {
+        if (!(duplicateRate >= 0.0 && duplicateRate < 1.0)) {
+            throw std::invalid_argument("ComplexGenerator: duplicateRate must be in [0, 1)");
+        }
+        duplicateThreshold = (uint64_t)(duplicateRate * 0x1.0p64);
+    }
+
+    // 第 i 个元素；重复段的长度期望为 1/(1-duplicateRate)，回溯代价为 O(1)
+    Complex at(size_t i) const {
+        while (isDuplicate(i)) i--;
+        return Complex(uniform(i, 0), uniform(i, 1));
+    }
+
+    // 用第 first 个起的元素填满 out
+    void fill(std::span<Complex> out, size_t first = 0, unsigned threads = std::thread::hardware_concurrency()) const {
+        parallelFor(out.size(), std::max(1u, threads), [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) out[k] = at(first + k);
+        });
+    }
+
+    void fill(ComplexArray& arr, size_t first = 0, unsigned threads = std::thread::hardware_concurrency()) const {
+        std::span<double> re = arr.realData(), im = arr.imagData();
+        parallelFor(arr.size(), std::max(1u, threads), [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                Complex c = at(first + k);
+                re[k] = c.getReal();
+                im[k] = c.getImag();
+            }
+        });
+    }
+
+    std::vector<Complex> generate(size_t n, unsigned threads = std::thread::hardware_concurrency()) const {
+        std::vector<Complex> vec(n);
+        fill(vec, 0, threads);
+        return vec;
+    }
+};
+
+// 选取方式：模最小、模最大、模最接近目标值
+typedef enum {
+    TOPK_SMALLEST,
+    TOPK_LARGEST,
+    TOPK_NEAREST
+} TopKMode;
+
+// 流式 top-k：只保留 k 个元素的有界堆，O(k) 内存、O(n log k) 时间。
+// 次序与 Complex::operator< 一致（先模、再实部、再虚部），但比较是精确的，
+// 以保证堆所需的严格弱序；可以分块 push，也可以合并多个线程各自的结果
+class TopKSelector {
+private:
+    struct Entry {
+        double score;  // 越小越优先
+        double mod;
+        double real;
+        double imag;
+    };
+
+    size_t k;
+    TopKMode mode;
+    double target;
+    std::vector<Entry> heap;  // 大顶堆：堆顶是当前保留的最差元素
+
+    // 按 (score, mod, real, imag) 比较；求最大时后三项取反
+    bool better(const Entry& a, const Entry& b) const {
+        if (mode == TOPK_LARGEST) {
+            return std::tie(a.score, b.mod, b.real, b.imag) < std::tie(b.score, a.mod, a.real, a.imag);
+        }
+        return std::tie(a.score, a.mod, a.real, a.imag) < std::tie(b.score, b.mod, b.real, b.imag);
+    }
+
+    double scoreOf(double mod) const {
+        switch (mode) {
+            case TOPK_LARGEST: return -mod;
+            case TOPK_NEAREST: return std::abs(mod - target);
+            default: return mod;
+        }
+    }
+
+    void pushEntry(const Entry& e) {
+        auto worse = [this](const Entry& a, const Entry& b) { return better(a, b); };
+        if (heap.size() < k) {
+            heap.push_back(e);
+            std::push_heap(heap.begin(), heap.end(), worse);
+        } else if (k > 0 && better(e, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), worse);
+            heap.back() = e;
+            std::push_heap(heap.begin(), heap.end(), worse);
+        }
+    }
+
+public:
+    TopKSelector(size_t k, TopKMode mode = TOPK_SMALLEST, double target = 0.0)
+        : k(k), mode(mode), target(target) {
+        heap.reserve(k);
+    }
+
+    void push(const Complex& c) {
+        double mod = c.getModulus();
+        double score = scoreOf(mod);
+        // 堆满后，分数明显更差的元素无需构造条目
+        if (heap.size() == k && (k == 0 || score > heap.front().score)) return;
+        pushEntry({score, mod, c.getReal(), c.getImag()});
+    }
+
+    void push(std::span<const Complex> chunk) {
+        for (const Complex& c : chunk) push(c);
+    }
+
+    // 合并另一个同参数选择器的结果
+    void merge(const TopKSelector& other) {
+        for (const Entry& e : other.heap) pushEntry(e);
+    }
+
+    // 结果按优先次序排列（最小、最大或最近的在前）
+    std::vector<Complex> result() const {
+        std::vector<Entry> sorted = heap;
+        std::sort(sorted.begin(), sorted.end(), [this](const Entry& a, const Entry& b) { return better(a, b); });
+        std::vector<Complex> out;
+        out.reserve(sorted.size());
+        for (const Entry& e : sorted) out.push_back(Complex(e.real, e.imag));
+        return out;
+    }
+};
+
+// 并行 top-k：每个线程维护自己的堆，最后合并
+std::vector<Complex> topK(std::span<const Complex> data, size_t k, TopKMode mode = TOPK_SMALLEST,
+                          double target = 0.0, unsigned threads = std::thread::hardware_concurrency()) {
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(std::max(1u, threads), data.size() / 65536));
+    std::vector<TopKSelector> partial(threads, TopKSelector(k, mode, target));
+    size_t chunk = (data.size() + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            size_t begin = std::min(data.size(), t * chunk);
+            partial[t].push(data.subspan(begin, std::min(data.size(), begin + chunk) - begin));
+        });
+    }
+    partial[0].push(data.subspan(0, std::min(data.size(), chunk)));
+    for (auto& w : workers) w.join();
+    for (unsigned t = 1; t < threads; ++t) partial[0].merge(partial[t]);
+    return partial[0].result();
+}
+
+// 复平面上的 k-d 树：隐式存储，区间 [lo, hi) 的中点即子树根，
+// 深度为偶数时按实部划分、奇数时按虚部划分。查询结果为元素在建树输入中的下标，
+// 范围查询默认 ORDER_INDEX，按树的遍历顺序返回；传 ORDER_BY_ID 时按下标升序，
+// 可与暴力扫描直接比较。kNN 总是按距离、再按下标排列
+class ComplexKdTree {
+private:
+    struct Point {
+        double x;
+        double y;
+        uint32_t id;
+    };
+
+    struct Box {
+        double xmin, xmax, ymin, ymax;
+
+        // 点到盒子的最近、最远距离的平方
+        double minDist2(double px, double py) const {
+            double dx = std::max({xmin - px, 0.0, px - xmax});
+            double dy = std::max({ymin - py, 0.0, py - ymax});
+            return dx * dx + dy * dy;
+        }
+        double maxDist2(double px, double py) const {
+            double dx = std::max(std::abs(px - xmin), std::abs(px - xmax));
+            double dy = std::max(std::abs(py - ymin), std::abs(py - ymax));
+            return dx * dx + dy * dy;
+        }
+    };
+
+    static const size_t LEAF = 16;
+    static const size_t PARALLEL_THRESHOLD = 1 << 16;
+
+    std::vector<Point> points;
+    Box bounds = {0, 0, 0, 0};
+
+    void build(size_t lo, size_t hi, int depth, int parallelDepth) {
+        if (hi - lo <= LEAF) return;
+        size_t mid = lo + (hi - lo) / 2;
+        auto byX = [](const Point& a, const Point& b) { return a.x < b.x; };
+        auto byY = [](const Point& a, const Point& b) { return a.y < b.y; };
+        if (depth % 2 == 0) {
+            std::nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi, byX);
+        } else {
+            std::nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi, byY);
+        }
+        if (parallelDepth > 0 && hi - lo >= PARALLEL_THRESHOLD) {
+            std::thread worker([=, this] { build(lo, mid, depth + 1, parallelDepth - 1); });
+            build(mid + 1, hi, depth + 1, parallelDepth - 1);
+            worker.join();
+        } else {
+            build(lo, mid, depth + 1, 0);
+            build(mid + 1, hi, depth + 1, 0);
+        }
+    }
+
+    // 以 box 为子树包围盒递归遍历：prune(box) 为真时跳过子树，visit(point) 处理每个点。
+    // 给出 focus 时先进入离它更近的子树，kNN 能更早收紧剪枝半径
+    template<typename Prune, typename Visit>
+    void traverse(size_t lo, size_t hi, int depth, Box box, Prune& prune, Visit& visit,
+                  const Complex* focus = nullptr) const {
+        if (lo >= hi || prune(box)) return;
+        if (hi - lo <= LEAF) {
+            for (size_t i = lo; i < hi; ++i) visit(points[i]);
+            return;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        const Point& p = points[mid];
+        visit(p);
+        Box left = box, right = box;
+        bool rightFirst = false;
+        if (depth % 2 == 0) {
+            left.xmax = right.xmin = p.x;
+            rightFirst = focus && focus->getReal() > p.x;
+        } else {
+            left.ymax = right.ymin = p.y;
+            rightFirst = focus && focus->getImag() > p.y;
+        }
+        if (rightFirst) {
+            traverse(mid + 1, hi, depth + 1, right, prune, visit, focus);
+            traverse(lo, mid, depth + 1, left, prune, visit, focus);
+        } else {
+            traverse(lo, mid, depth + 1, left, prune, visit, focus);
+            traverse(mid + 1, hi, depth + 1, right, prune, visit, focus);
+        }
+    }
+
+public:
+    ComplexKdTree() {}
+
+    explicit ComplexKdTree(std::span<const Complex> data, unsigned threads = std::thread::hardware_concurrency()) {
+        if (data.size() >= UINT32_MAX) throw std::length_error("ComplexKdTree: too many elements");
+        points.resize(data.size());
+        for (size_t i = 0; i < data.size(); ++i) {
+            points[i] = {data[i].getReal(), data[i].getImag(), (uint32_t)i};
+        }
+        if (!points.empty()) {
+            bounds = {points[0].x, points[0].x, points[0].y, points[0].y};
+            for (const Point& p : points) {
+                bounds.xmin = std::min(bounds.xmin, p.x);
+                bounds.xmax = std::max(bounds.xmax, p.x);
+                bounds.ymin = std::min(bounds.ymin, p.y);
+                bounds.ymax = std::max(bounds.ymax, p.y);
+            }
+        }
+        int parallelDepth = 0;
+        while ((1u << parallelDepth) < std::max(1u, threads)) parallelDepth++;
+        build(0, points.size(), 0, parallelDepth);
+    }
+
+    size_t size() const { return points.size(); }
+
+    // 实部在 [xmin, xmax]、虚部在 [ymin, ymax] 内的元素；默认按树的遍历顺序
+    std::vector<size_t> rectangle(double xmin, double xmax, double ymin, double ymax,
+                                  ResultOrder order = ORDER_INDEX) const {
+        std::vector<size_t> ids;
+        auto prune = [&](const Box& b) { return b.xmax < xmin || b.xmin > xmax || b.ymax < ymin || b.ymin > ymax; };
+        auto visit = [&](const Point& p) {
+            if (p.x >= xmin && p.x <= xmax && p.y >= ymin && p.y <= ymax) ids.push_back(p.id);
+        };
+        traverse(0, points.size(), 0, bounds, prune, visit);
+        if (order == ORDER_BY_ID) std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // 与 center 距离在 [r1, r2] 内的元素；r1 = 0 即圆盘
+    std::vector<size_t> annulus(const Complex& center, double r1, double r2,
+                                ResultOrder order = ORDER_INDEX) const {
+        std::vector<size_t> ids;
+        double cx = center.getReal(), cy = center.getImag();
+        double inner = r1 * r1, outer = r2 * r2;
+        auto prune = [&](const Box& b) { return b.minDist2(cx, cy) > outer || b.maxDist2(cx, cy) < inner; };
+        auto visit = [&](const Point& p) {
+            double dx = p.x - cx, dy = p.y - cy;
+            double d2 = dx * dx + dy * dy;
+            if (d2 >= inner && d2 <= outer) ids.push_back(p.id);
+        };
+        traverse(0, points.size(), 0, bounds, prune, visit);
+        if (order == ORDER_BY_ID) std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    std::vector<size_t> disc(const Complex& center, double r, ResultOrder order = ORDER_INDEX) const {
+        return annulus(center, 0.0, r, order);
+    }
+
+    // 距 z 最近的 k 个元素，按 (距离, 下标) 升序
+    std::vector<size_t> nearest(const Complex& z, size_t k) const {
+        double zx = z.getReal(), zy = z.getImag();
+        std::vector<std::pair<double, size_t>> heap;  // 大顶堆，堆顶为当前第 k 近
+        heap.reserve(k);
+        auto prune = [&](const Box& b) { return heap.size() == k && (k == 0 || b.minDist2(zx, zy) > heap.front().first); };
+        auto visit = [&](const Point& p) {
+            double dx = p.x - zx, dy = p.y - zy;
+            std::pair<double, size_t> entry(dx * dx + dy * dy, p.id);
+            if (heap.size() < k) {
+                heap.push_back(entry);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (k > 0 && entry < heap.front()) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = entry;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        };
+        traverse(0, points.size(), 0, bounds, prune, visit, &z);
+        std::sort(heap.begin(), heap.end());
+        std::vector<size_t> ids;
+        for (const auto& entry : heap) ids.push_back(entry.second);
+        return ids;
+    }
+};
+
+// 暴力版本的圆环查询与 kNN，作为 k-d 树的对照
+std::vector<size_t> bruteAnnulus(std::span<const Complex> data, const Complex& center, double r1, double r2) {
+    std::vector<size_t> ids;
+    for (size_t i = 0; i < data.size(); ++i) {
+        double dx = data[i].getReal() - center.getReal(), dy = data[i].getImag() - center.getImag();
+        double d2 = dx * dx + dy * dy;
+        if (d2 >= r1 * r1 && d2 <= r2 * r2) ids.push_back(i);
+    }
+    return ids;
+}
+
+std::vector<size_t> bruteNearest(std::span<const Complex> data, const Complex& z, size_t k) {
+    std::vector<std::pair<double, size_t>> all;
+    for (size_t i = 0; i < data.size(); ++i) {
+        double dx = data[i].getReal() - z.getReal(), dy = data[i].getImag() - z.getImag();
+        all.push_back({dx * dx + dy * dy, i});
+    }
+    k = std::min(k, all.size());
+    std::partial_sort(all.begin(), all.begin() + k, all.end());
+    std::vector<size_t> ids;
+    for (size_t i = 0; i < k; ++i) ids.push_back(all[i].second);
+    return ids;
+}
+
+void printVector(const std::vector<Complex>& vec, const std::string& title = "") {
+    if (!title.empty()) {
+        std::cout << title << ":" << std::endl;
+    }
+    for (size_t i = 0; i < vec.size(); ++i) {
+        std::cout << vec[i] << " ";
+        if ((i + 1) % 5 == 0 && i != vec.size() - 1)
+            std::cout << std::endl;
+    }
+    std::cout << std::endl << std::endl;
+}
+
+// 与 operator<< 相同的 (a+bi) 文本格式
+void writeComplex(FastWriter& out, const Complex& c) {
+    out.put('(').putGeneral(c.getReal());
+    if (c.getImag() >= 0) out.put('+');
+    out.putGeneral(c.getImag()).put("i)");
+}
+
+// 批量输出，与 printVector 的输出逐字节一致，但只在缓冲区满时写一次
+void writeVector(FastWriter& out, const std::vector<Complex>& vec, const std::string& title = "") {
+    if (!title.empty()) {
+        out.put(title).put(":\n");
+    }
+    for (size_t i = 0; i < vec.size(); ++i) {
+        writeComplex(out, vec[i]);
+        out.put(' ');
+        if ((i + 1) % 5 == 0 && i != vec.size() - 1)
+            out.put('\n');
+    }
+    out.put("\n\n");
+}
+
+// CSV 输出：每行 real,imag，采用最短可精确回读的表示，读回无损
+void writeCsv(FastWriter& out, const std::vector<Complex>& vec) {
+    out.put("real,imag\n");
+    for (const Complex& c : vec) {
+        out.putExact(c.getReal()).put(',').putExact(c.getImag()).put('\n');
+    }
+}
+
+// 结构数组与 vector<Complex> 的区间查找、求模性能对比
+void benchmarkComplexArray(size_t maxSize) {
+    std::mt19937 gen(12345);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+
+    std::cout << "结构数组性能测试：" << std::endl;
+    for (size_t n = 10000; n <= maxSize; n *= 10) {
+        std::vector<Complex> vec;
+        vec.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            vec.push_back(Complex(dis(gen), dis(gen)));
+        }
+        ComplexArray arr(vec);
+        int repeats = (int)std::max<size_t>(1, 10000000 / n);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t vecHits = 0;
+        for (int r = 0; r < repeats; ++r) {
+            vecHits += rangeSearch(vec, 3.0, 7.0).size();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double vecTime = std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+
+        start = std::chrono::high_resolution_clock::now();
+        size_t arrHits = 0;
+        for (int r = 0; r < repeats; ++r) {
+            arrHits += arr.rangeIndices(3.0, 7.0).size();
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double arrTime = std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+
+        AlignedDoubles mods(n);
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            arr.modulus(mods);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double modTime = std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+        double bandwidth = 2.0 * n * sizeof(double) / (arrTime * 1e6);
+
+        std::cout << "  n = " << n << ": rangeSearch " << vecTime << " 毫秒, ComplexArray "
+                  << arrTime << " 毫秒 (" << bandwidth << " GB/s), 加速比 " << vecTime / arrTime
+                  << "x, 批量求模 " << modTime << " 毫秒"
+                  << (vecHits == arrHits ? "" : " [结果不一致]") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// 排序性能对比：bubbleSort 只在小规模上运行
+void benchmarkSort(size_t maxSize) {
+    std::mt19937 gen(54321);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+    ComplexSorter sorter;
+
+    std::cout << "排序性能测试 (" << std::thread::hardware_concurrency() << " 线程)：" << std::endl;
+    for (size_t n = 10000; n <= maxSize; n *= 10) {
+        std::vector<Complex> input;
+        input.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            input.push_back(Complex(dis(gen), dis(gen)));
+        }
+        std::cout << "  n = " << n << ":";
+
+        std::vector<Complex> bubbled;
+        if (n <= 10000) {
+            bubbled = input;
+            auto start = std::chrono::high_resolution_clock::now();
+            bubbleSort(bubbled);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout << " bubbleSort " << std::chrono::duration<double, std::milli>(end - start).count() << " 毫秒,";
+        }
+
+        std::vector<Complex> merged = input;
+        auto start = std::chrono::high_resolution_clock::now();
+        mergeSort(merged);
+        auto end = std::chrono::high_resolution_clock::now();
+        double mergeTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::vector<Complex> sorted = input;
+        start = std::chrono::high_resolution_clock::now();
+        sorter.sort(sorted, 1);
+        end = std::chrono::high_resolution_clock::now();
+        double serialTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        sorted = input;
+        start = std::chrono::high_resolution_clock::now();
+        sorter.sort(sorted);
+        end = std::chrono::high_resolution_clock::now();
+        double parallelTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        bool same = sorted.size() == merged.size();
+        for (size_t i = 0; same && i < sorted.size(); ++i) {
+            same = sorted[i].getReal() == merged[i].getReal() && sorted[i].getImag() == merged[i].getImag();
+        }
+        std::cout << " mergeSort " << mergeTime << " 毫秒, ComplexSorter 单线程 " << serialTime
+                  << " 毫秒, 并行 " << parallelTime << " 毫秒, 加速比 " << mergeTime / parallelTime << "x"
+                  << (same ? "" : " [与 mergeSort 结果不一致]") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// 反复区间查询：线性扫描与 ModulusIndex 对比
+void benchmarkModulusIndex(size_t maxSize) {
+    std::mt19937 gen(2024);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+    const int queries = 1000;
+
+    std::cout << "模索引性能测试 (" << queries << " 次窄区间查询)：" << std::endl;
+    for (size_t n = 10000; n <= std::min<size_t>(maxSize, 1000000); n *= 10) {
+        std::vector<Complex> vec;
+        vec.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            vec.push_back(Complex(dis(gen), dis(gen)));
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ModulusIndex index(vec);
+        auto end = std::chrono::high_resolution_clock::now();
+        double buildTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::vector<double> lows(queries);
+        for (double& m : lows) m = std::abs(dis(gen));
+
+        start = std::chrono::high_resolution_clock::now();
+        size_t linearHits = 0;
+        for (double m : lows) linearHits += rangeSearch(vec, m, m + 0.01).size();
+        end = std::chrono::high_resolution_clock::now();
+        double linearTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        size_t indexHits = 0;
+        for (double m : lows) indexHits += index.rangeSearch(m, m + 0.01).size();
+        end = std::chrono::high_resolution_clock::now();
+        double indexTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "  n = " << n << ": 建索引 " << buildTime << " 毫秒, 线性 " << linearTime
+                  << " 毫秒, 索引 " << indexTime << " 毫秒, 加速比 " << linearTime / indexTime << "x"
+                  << (linearHits == indexHits ? "" : " [结果不一致]") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// 去重性能测试：约三分之一元素是更早元素的副本
+void benchmarkUnique(size_t maxSize) {
+    std::mt19937 gen(777);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+
+    std::cout << "去重性能测试：" << std::endl;
+    for (size_t n = 10000; n <= maxSize; n *= 10) {
+        std::vector<Complex> input;
+        input.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (i % 3 == 2) {
+                input.push_back(input[gen() % i]);
+            } else {
+                input.push_back(Complex(dis(gen), dis(gen)));
+            }
+        }
+        std::shuffle(input.begin(), input.end(), gen);
+
+        std::vector<Complex> grid = input;
+        auto start = std::chrono::high_resolution_clock::now();
+        uniqueByGrid(grid);
+        auto end = std::chrono::high_resolution_clock::now();
+        double gridTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::vector<Complex> sorted = input;
+        start = std::chrono::high_resolution_clock::now();
+        uniqueBySort(sorted);
+        end = std::chrono::high_resolution_clock::now();
+        double sortTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "  n = " << n << ": 网格哈希 " << gridTime << " 毫秒 (剩 " << grid.size()
+                  << "), 排序去重 " << sortTime << " 毫秒 (剩 " << sorted.size() << ")" << std::endl;
+
+        // 重复极多的输入：全部相同，以及 99.9% 的元素重复前一元素。
+        // 每个元素只与格内保留者比较，耗时应与上面的普通输入同一量级
+        std::vector<Complex> same(n, Complex(1.0, -1.0));
+        std::vector<Complex> runs = ComplexGenerator(n, -10.0, 10.0, 0.999).generate(n);
+        start = std::chrono::high_resolution_clock::now();
+        uniqueByGrid(same);
+        end = std::chrono::high_resolution_clock::now();
+        double sameTime = std::chrono::duration<double, std::milli>(end - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        uniqueByGrid(runs);
+        end = std::chrono::high_resolution_clock::now();
+        double runsTime = std::chrono::duration<double, std::milli>(end - start).count();
+        double bound = 4 * gridTime + 20;
+        std::cout << "    全部相同 " << sameTime << " 毫秒 (剩 " << same.size() << "), 99.9% 重复 "
+                  << runsTime << " 毫秒 (剩 " << runs.size() << ")"
+                  << (sameTime > bound || runsTime > bound ? " [超出线性时间上界]" : "") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// 随机位置编辑：逐个 insert/erase、批量编辑与分块序列对比
+void benchmarkEdits(size_t maxSize) {
+    std::mt19937 gen(99);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+    const size_t edits = 2000;
+
+    std::cout << "随机位置编辑性能测试 (" << edits << " 次插入/删除)：" << std::endl;
+    for (size_t n = 100000; n <= maxSize; n *= 10) {
+        std::vector<Complex> input(n);
+        for (auto& c : input) c = Complex(dis(gen), dis(gen));
+        std::vector<VectorEdit> batch;
+        for (size_t k = 0; k < edits; ++k) {
+            batch.push_back({gen() % n, k % 2 == 1, Complex(dis(gen), dis(gen))});
+        }
+
+        // 逐个编辑：按位置从大到小应用，原始下标不受前面编辑影响；
+        // 同一位置先删除，再按相反顺序插入，才与批量编辑的语义一致
+        std::vector<VectorEdit> ordered(batch.rbegin(), batch.rend());
+        std::stable_sort(ordered.begin(), ordered.end(), [](const VectorEdit& a, const VectorEdit& b) {
+            return a.position != b.position ? a.position > b.position : a.erase > b.erase;
+        });
+        std::vector<Complex> single = input;
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t lastErased = SIZE_MAX;
+        for (const VectorEdit& e : ordered) {
+            if (!e.erase) {
+                single.insert(single.begin() + e.position, e.value);
+            } else if (e.position != lastErased) {
+                single.erase(single.begin() + e.position);
+                lastErased = e.position;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double singleTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::vector<Complex> batched = input;
+        start = std::chrono::high_resolution_clock::now();
+        applyEdits(batched, batch);
+        end = std::chrono::high_resolution_clock::now();
+        double batchTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        ComplexBlockList blockList(input);
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t k = 0; k < edits; ++k) {
+            if (k % 2 == 0) {
+                blockList.insert(gen() % blockList.size(), Complex(dis(gen), dis(gen)));
+            } else {
+                blockList.erase(gen() % blockList.size());
+            }
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double blockTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        // 随机删除九成元素，小块应当被合并，块数随元素数减少
+        size_t remaining = blockList.size() / 10;
+        while (blockList.size() > remaining) {
+            blockList.erase(gen() % blockList.size());
+        }
+
+        bool same = single.size() == batched.size();
+        for (size_t i = 0; same && i < single.size(); ++i) {
+            same = single[i].getReal() == batched[i].getReal() && single[i].getImag() == batched[i].getImag();
+        }
+        std::cout << "  n = " << n << ": 逐个编辑 " << singleTime << " 毫秒, 批量编辑 " << batchTime
+                  << " 毫秒, 分块序列 " << blockTime << " 毫秒" << (same ? "" : " [结果不一致]")
+                  << ", 删除九成后 " << blockList.size() << " 个元素 / " << blockList.blockCount() << " 块" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// 列式文件：保存、映射打开与在映射内存上区间查找的耗时
+void benchmarkStorage(size_t maxSize) {
+    std::mt19937 gen(31);
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+    const std::string dataFile = "complex_bench.bin";
+
+    std::cout << "列式文件性能测试：" << std::endl;
+    for (size_t n = 100000; n <= maxSize; n *= 10) {
+        ComplexArray arr(n);
+        for (size_t i = 0; i < n; ++i) arr.set(i, Complex(dis(gen), dis(gen)));
+
+        auto start = std::chrono::high_resolution_clock::now();
+        saveComplexFile(dataFile, arr);
+        auto end = std::chrono::high_resolution_clock::now();
+        double saveTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        ComplexFileView view(dataFile);
+        end = std::chrono::high_resolution_clock::now();
+        double openTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        size_t hits = view.rangeIndices(3.0, 7.0).size();
+        end = std::chrono::high_resolution_clock::now();
+        double rangeTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "  n = " << n << " (" << n * 16 / 1048576.0 << " MB): 保存 " << saveTime
+                  << " 毫秒, 打开 " << openTime << " 毫秒, 映射区间查找 " << rangeTime << " 毫秒"
+                  << (hits == arr.rangeIndices(3.0, 7.0).size() ? "" : " [结果不一致]") << std::endl;
+    }
+    std::remove(dataFile.c_str());
+    std::cout << std::endl;
+}
+
+// 随机数据生成：mt19937 串行生成与计数器生成器对比
+void benchmarkGenerator(size_t maxSize) {
+    std::cout << "随机数据生成性能测试：" << std::endl;
+    for (size_t n = 100000; n <= maxSize; n *= 10) {
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<> dis(-10.0, 10.0);
+        std::vector<Complex> serial(n);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto& c : serial) {
+            double real = dis(gen);
+            double imag = dis(gen);
+            c = Complex(real, imag);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double mtTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        ComplexGenerator generator(1, -10.0, 10.0, 0.25);
+        std::vector<Complex> filled(n);
+        start = std::chrono::high_resolution_clock::now();
+        generator.fill(filled);
+        end = std::chrono::high_resolution_clock::now();
+        double fillTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        // 同一种子下单线程与多线程结果应逐位一致
+        std::vector<Complex> single(n);
+        generator.fill(single, 0, 1);
+        bool same = true;
+        for (size_t i = 0; same && i < n; ++i) {
+            same = single[i].getReal() == filled[i].getReal() && single[i].getImag() == filled[i].getImag();
+        }
+        std::cout << "  n = " << n << ": mt19937 " << mtTime << " 毫秒, 计数器生成器 " << fillTime
+                  << " 毫秒 (" << n * sizeof(Complex) / (fillTime * 1e6) << " GB/s)"
+                  << (same ? "" : " [与线程数有关]") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// top-k 与完整排序后取前 k 个对比
+void benchmarkTopK(size_t maxSize) {
+    const size_t k = 100;
+    std::cout << "top-k 性能测试 (k = " << k << ")：" << std::endl;
+    for (size_t n = 100000; n <= maxSize; n *= 10) {
+        std::vector<Complex> input = ComplexGenerator(n).generate(n);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<Complex> sorted = input;
+        ComplexSorter().sort(sorted);
+        sorted.resize(k);
+        auto end = std::chrono::high_resolution_clock::now();
+        double sortTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<Complex> smallest = topK(input, k);
+        end = std::chrono::high_resolution_clock::now();
+        double topTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<Complex> nearest = topK(input, k, TOPK_NEAREST, 5.0);
+        end = std::chrono::high_resolution_clock::now();
+        double nearTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "  n = " << n << ": 排序取前 k " << sortTime << " 毫秒, topK " << topTime
+                  << " 毫秒, 最近邻 " << nearTime << " 毫秒" << (smallest == sorted ? "" : " [结果不一致]")
+                  << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// k-d 树：建树与查询耗时，并抽查与暴力扫描一致
+void benchmarkKdTree(size_t maxSize) {
+    const int queries = 1000;
+    std::cout << "k-d 树性能测试 (" << queries << " 次圆盘查询与 10-NN)：" << std::endl;
+    for (size_t n = 100000; n <= maxSize; n *= 10) {
+        std::vector<Complex> input = ComplexGenerator(n + 1).generate(n);
+        ComplexGenerator centers(n + 2);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ComplexKdTree tree(input);
+        auto end = std::chrono::high_resolution_clock::now();
+        double buildTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        size_t hits = 0;
+        for (int q = 0; q < queries; ++q) hits += tree.disc(centers.at(q), 0.5).size();
+        end = std::chrono::high_resolution_clock::now();
+        double discTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int q = 0; q < queries; ++q) hits += tree.nearest(centers.at(q), 10).size();
+        end = std::chrono::high_resolution_clock::now();
+        double knnTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        bool same = true;
+        for (int q = 0; q < 10; ++q) {
+            same = same && tree.disc(centers.at(q), 0.5, ORDER_BY_ID) == bruteAnnulus(input, centers.at(q), 0, 0.5) &&
+                   tree.nearest(centers.at(q), 10) == bruteNearest(input, centers.at(q), 10);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double bruteTime = std::chrono::duration<double, std::milli>(end - start).count() / 10;
+
+        std::cout << "  n = " << n << ": 建树 " << buildTime << " 毫秒, 圆盘查询 " << discTime / queries * 1000
+                  << " 微秒/次, 10-NN " << knnTime / queries * 1000 << " 微秒/次, 暴力扫描 " << bruteTime
+                  << " 毫秒/次" << (same ? "" : " [结果不一致]") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+// 输出性能：printVector 与 FastWriter 写入同样的文件（endl 的刷新开销计入）
+void benchmarkOutput(size_t maxSize) {
+    const std::string slowFile = "complex_print.txt", fastFile = "complex_fast.txt", csvFile = "complex_fast.csv";
+    auto readAll = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    std::cout << "输出性能测试：" << std::endl;
+    for (size_t n = 100000; n <= std::min<size_t>(maxSize, 10000000); n *= 10) {
+        std::vector<Complex> input = ComplexGenerator(n + 3).generate(n);
+
+        double printTime, writeTime, csvTime;
+        {
+            std::ofstream slow(slowFile, std::ios::binary);
+            std::streambuf* original = std::cout.rdbuf(slow.rdbuf());
+            auto start = std::chrono::high_resolution_clock::now();
+            printVector(input, "数据");
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout.rdbuf(original);
+            printTime = std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        {
+            std::ofstream fast(fastFile, std::ios::binary);
+            auto start = std::chrono::high_resolution_clock::now();
+            {
+                FastWriter out(&fast);
+                writeVector(out, input, "数据");
+            }
+            fast.flush();
+            auto end = std::chrono::high_resolution_clock::now();
+            writeTime = std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        {
+            std::ofstream csv(csvFile, std::ios::binary);
+            auto start = std::chrono::high_resolution_clock::now();
+            {
+                FastWriter out(&csv);
+                writeCsv(out, input);
+            }
+            csv.flush();
+            auto end = std::chrono::high_resolution_clock::now();
+            csvTime = std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        std::cout << "  n = " << n << ": printVector " << printTime << " 毫秒, FastWriter " << writeTime
+                  << " 毫秒, 加速比 " << printTime / writeTime << "x, CSV " << csvTime << " 毫秒"
+                  << (readAll(slowFile) == readAll(fastFile) ? "" : " [输出不一致]") << std::endl;
+    }
+    std::remove(slowFile.c_str());
+    std::remove(fastFile.c_str());
+    std::remove(csvFile.c_str());
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Complex --bench [最大规模]：只运行性能测试
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        size_t maxSize = argc > 2 ? std::stoull(argv[2]) : 10000000;
+        benchmarkComplexArray(maxSize);
+        benchmarkSort(maxSize);
+        benchmarkModulusIndex(maxSize);
+        benchmarkUnique(maxSize);
+        benchmarkEdits(maxSize);
+        benchmarkStorage(maxSize);
+        benchmarkGenerator(maxSize);
+        benchmarkTopK(maxSize);
+        benchmarkKdTree(maxSize);
+        benchmarkOutput(maxSize);
+        return 0;
+    }
+
+    // Complex --seed N：用指定种子复现一次运行
+    uint64_t seed;
+    if (argc > 2 && std::strcmp(argv[1], "--seed") == 0) {
+        seed = std::stoull(argv[2]);
+    } else {
+        std::random_device rd;
+        seed = ((uint64_t)rd() << 32) | rd();
+    }
+    std::mt19937 gen((uint32_t)splitMix64(seed));
+    std::uniform_real_distribution<> dis(-10.0, 10.0);
+
+    int numComplex = 15;
+    std::cout << "生成 " << numComplex << " 随机复数 (种子 " << seed << ")..." << std::endl;
+
+    // 约四分之一的元素重复前一个元素
+    ComplexGenerator generator(seed, -10.0, 10.0, 0.25);
+    std::vector<Complex> complexVector = generator.generate(numComplex);
+
+    printVector(complexVector, "原始随机复数");
+
+    std::cout << "(1) 基础操作" << std::endl;
+
+    // 置乱
+    std::shuffle(complexVector.begin(), complexVector.end(), gen);
+    printVector(complexVector, "打乱后的复数");
+
+    // 查找
+    if (!complexVector.empty()) {
+        Complex target = complexVector[complexVector.size() / 2];
+        int index = findComplex(complexVector, target); 
+        std::cout << "查找 " << target << ": Index = " << index << std::endl << std::endl;
+    }
+
+    std::vector<Complex> beforeEdits = complexVector;
+
+    // 插入
+    Complex newComplex(dis(gen), dis(gen));
+    complexVector.insert(complexVector.begin() + 3, newComplex);
+    std::cout << "插入后 " << newComplex << " at index 3" << std::endl;
+    printVector(complexVector);
+
+    // 删除
+    if (complexVector.size() > 5) {
+        complexVector.erase(complexVector.begin() + 2);
+        printVector(complexVector, "删除后元素");
+
+        // 同样的插入、删除用批量编辑和分块序列各做一遍，位置按原始下标给出
+        std::vector<Complex> edited = beforeEdits;
+        applyEdits(edited, {{3, false, newComplex}, {2, true, Complex()}});
+        ComplexBlockList blockList(beforeEdits);
+        blockList.insert(3, newComplex);
+        blockList.erase(2);
+        std::cout << "批量编辑结果一致: " << (edited == complexVector ? "是" : "否")
+                  << ", 分块序列结果一致: " << (blockList.toVector() == complexVector ? "是" : "否")
+                  << std::endl << std::endl;
+    }
+
+    // 唯一化：uniqueVector 只去掉相邻重复，置乱后的重复由 uniqueByGrid 去除
+    std::vector<Complex> beforeUnique = complexVector;
+    uniqueVector(complexVector);
+    printVector(complexVector, "唯一化后元素");
+
+    uniqueByGrid(complexVector);
+    printVector(complexVector, "网格哈希去重后元素");
+
+    std::vector<Complex> sortedUnique = beforeUnique;
+    uniqueBySort(sortedUnique);
+    printVector(sortedUnique, "排序去重后元素");
+
+    // 排序
+    std::vector<Complex> merged = complexVector;
+    mergeSort(merged);
+    std::vector<Complex> sorted = complexVector;
+    sortByModulus(sorted);
+    printVector(sorted, "按模排序后元素");
+    std::cout << "与 mergeSort 结果一致: " << (sorted == merged ? "是" : "否") << std::endl << std::endl;
+
+    // 模索引：区间查询与查找应与线性版本一致，插入删除后同步更新
+    ModulusIndex index(complexVector);
+    bool indexMatches = index.rangeSearch(3.0, 8.0, ORDER_BY_ID) == rangeSearch(complexVector, 3.0, 8.0);
+    for (const Complex& c : complexVector) {
+        indexMatches = indexMatches && index.find(c) == findComplex(complexVector, c);
+    }
+    Complex extra(1.5, -2.5);
+    index.insert(complexVector.size(), extra);
+    index.erase(0);
+    std::cout << "模索引与线性查找一致: " << (indexMatches ? "是" : "否")
+              << ", 插入后查找 " << extra << ": id = " << index.find(extra)
+              << ", 删除后 id 0 存在: " << (index.contains(0) ? "是" : "否") << std::endl << std::endl;
+
+    // top-k：结果应与按模排序后取前 k 个一致
+    std::vector<Complex> smallest = topK(complexVector, 3);
+    std::vector<Complex> largest = topK(complexVector, 3, TOPK_LARGEST);
+    std::vector<Complex> nearest = topK(complexVector, 3, TOPK_NEAREST, 5.0);
+    printVector(smallest, "模最小的 3 个元素");
+    printVector(largest, "模最大的 3 个元素");
+    printVector(nearest, "模最接近 5 的 3 个元素");
+    std::vector<Complex> expected(sorted.begin(), sorted.begin() + std::min<size_t>(3, sorted.size()));
+    std::cout << "与排序结果一致: " << (smallest == expected ? "是" : "否") << std::endl << std::endl;
+
+    // 空间索引：矩形、圆环、kNN 查询应与暴力扫描一致
+    ComplexKdTree kdTree(complexVector);
+    std::vector<size_t> inRect;
+    for (size_t i = 0; i < complexVector.size(); ++i) {
+        if (complexVector[i].getReal() >= -5 && complexVector[i].getReal() <= 5 &&
+            complexVector[i].getImag() >= 0 && complexVector[i].getImag() <= 10) {
+            inRect.push_back(i);
+        }
+    }
+    Complex origin(1, 1);
+    std::cout << "k-d 树: 矩形 " << kdTree.rectangle(-5, 5, 0, 10).size() << " 个, 圆环 "
+              << kdTree.annulus(origin, 3, 8).size() << " 个, 与暴力扫描一致: "
+              << (kdTree.rectangle(-5, 5, 0, 10, ORDER_BY_ID) == inRect &&
+                  kdTree.annulus(origin, 3, 8, ORDER_BY_ID) == bruteAnnulus(complexVector, origin, 3, 8) &&
+                  kdTree.disc(origin, 6, ORDER_BY_ID) == bruteAnnulus(complexVector, origin, 0, 6) &&
+                  kdTree.nearest(origin, 4) == bruteNearest(complexVector, origin, 4) ? "是" : "否")
+              << std::endl << std::endl;
+
+    std::cout << "(2) 结构数组 ComplexArray" << std::endl;
+
+    ComplexArray arr(complexVector);
+    std::vector<Complex> inRange = rangeSearch(complexVector, 5.0, 10.0);
+    std::vector<Complex> arrInRange = rangeSearch(arr, 5.0, 10.0).toVector();
+    printVector(arrInRange, "模在 [5, 10] 内的元素");
+    std::cout << "与 vector 版本区间查找一致: " << (inRange == arrInRange ? "是" : "否") << std::endl;
+
+    std::vector<double> mods(arr.size());
+    arr.modulus(mods);
+    bool modulusMatches = true;
+    for (size_t i = 0; i < arr.size(); ++i) {
+        modulusMatches = modulusMatches && mods[i] == complexVector[i].getModulus();
+    }
+    std::cout << "批量求模与 getModulus 一致: " << (modulusMatches ? "是" : "否") << std::endl;
+
+    // z * conj(z) + z 的实部应为 |z|^2 + Re(z)，虚部为 Im(z)
+    ComplexArray product = arr;
+    product.conjugate();
+    product *= arr;
+    product += arr;
+    std::vector<double> norms(arr.size());
+    arr.normSquared(norms);
+    bool arithmeticMatches = true;
+    for (size_t i = 0; i < arr.size(); ++i) {
+        arithmeticMatches = arithmeticMatches &&
+            std::abs(product[i].getReal() - (norms[i] + arr[i].getReal())) < 1e-9 &&
+            std::abs(product[i].getImag() - arr[i].getImag()) < 1e-9;
+    }
+    std::cout << "共轭、乘法与加法结果正确: " << (arithmeticMatches ? "是" : "否") << std::endl << std::endl;
+
+    // 快速输出：与 printVector 逐字节一致
+    std::ostringstream expectedText, actualText;
+    std::streambuf* original = std::cout.rdbuf(expectedText.rdbuf());
+    printVector(complexVector, "唯一化后元素");
+    std::cout.rdbuf(original);
+    {
+        FastWriter out(&actualText);
+        writeVector(out, complexVector, "唯一化后元素");
+    }
+    std::cout << "FastWriter 与 printVector 输出一致: " << (expectedText.str() == actualText.str() ? "是" : "否")
+              << std::endl << std::endl;
+
+    std::cout << "(3) 列式二进制文件" << std::endl;
+
+    // 按模排序后保存，再通过内存映射读回
+    const std::string dataFile = "complex_demo.bin";
+    saveComplexFile(dataFile, sorted, true);
+    {
+        ComplexFileView view(dataFile);
+        bool roundTrip = view.size() == sorted.size();
+        for (size_t i = 0; roundTrip && i < view.size(); ++i) {
+            roundTrip = view[i].getReal() == sorted[i].getReal() && view[i].getImag() == sorted[i].getImag();
+        }
+        std::vector<Complex> fromFile;
+        for (size_t i : view.rangeIndices(5.0, 10.0)) fromFile.push_back(view[i]);
+        std::cout << "读回 " << view.size() << " 个元素, 按模排序: " << (view.sortedByModulus() ? "是" : "否")
+                  << ", 逐位一致: " << (roundTrip ? "是" : "否")
+                  << ", 区间查找一致: " << (fromFile == rangeSearch(sorted, 5.0, 10.0) ? "是" : "否")
+                  << std::endl << std::endl;
+    }
+    std::remove(dataFile.c_str());
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+#ifndef FAST_WRITER_H
+#define FAST_WRITER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 带大缓冲区的文本输出：数字用 std::to_chars 直接格式化进缓冲区，
+// 缓冲区满时对输出流整块 write 一次，避免 iostream 逐项格式化与 endl 刷新。
+// sink 为空时为内存模式，缓冲区按需增长，内容由 view() 取出
+class FastWriter {
+private:
+    std::ostream* sink;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    // 保证还有 n 字节空间
+    char* reserve(size_t n) {
+        if (buffer.size() - used < n) {
+            if (sink) flush();
+            if (buffer.size() - used < n) buffer.resize(std::max(buffer.size() * 2, used + n));
+        }
+        return buffer.data() + used;
+    }
+
+public:
+    // %g 的快速路径：只处理定点形式（十进制指数在 [-4, precision) 内）。
+    // 先乘以 10 的整数次幂（精确值，一次舍入）再四舍五入到 precision 位有效数字；
+    // 乘积离 .5 太近、可能舍入方向不定时返回 nullptr，交给 to_chars 精确处理
+    static char* generalFast(char* out, double value, int precision) {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19};
+        if (precision < 1 || precision > 15) return nullptr;
+        double a = value < 0 ? -value : value;
+        if (!(a >= 1e-4 && a < 1e15)) return nullptr;  // 同时排除 0、NaN 与无穷
+
+        // thresholds[i] = 10^(i-3)，用于估计十进制指数
+        static const double thresholds[] = {1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                            1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+        int exponent = -4;
+        while (exponent < precision - 1 && a >= thresholds[exponent + 4]) exponent++;
+        uint64_t low = (uint64_t)powers[precision - 1];
+        uint64_t digits = 0;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            int shift = precision - 1 - exponent;
+            if (shift < 0 || shift > 19) return nullptr;
+            double y = a * powers[shift];
+            double whole = (double)(uint64_t)y;
+            double frac = y - whole;
+            if (std::abs(frac - 0.5) <= y * 1e-15) return nullptr;
+            digits = (uint64_t)whole + (frac > 0.5 ? 1 : 0);
+            if (digits >= low) break;
+            exponent--;  // 估计的指数偏大一位
+        }
+        if (digits < low) return nullptr;
+        if (digits >= low * 10) {  // 进位到下一个数量级，如 9.999996 -> 10
+            digits /= 10;
+            exponent++;
+        }
+        if (exponent < -4 || exponent >= precision) return nullptr;
+
+        char text[16];
+        for (int i = precision - 1; i >= 0; i--) {
+            text[i] = (char)('0' + digits % 10);
+            digits /= 10;
+        }
+        int last = precision - 1;  // 去掉小数部分末尾的 0
+        int minLast = exponent >= 0 ? exponent : 0;
+        while (last > minLast && text[last] == '0') last--;
+
+        if (value < 0) *out++ = '-';
+        if (exponent >= 0) {
+            for (int i = 0; i <= exponent; i++) *out++ = text[i];
+            if (last > exponent) {
+                *out++ = '.';
+                for (int i = exponent + 1; i <= last; i++) *out++ = text[i];
+            }
+        } else {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = 0; i < -exponent - 1; i++) *out++ = '0';
+            for (int i = 0; i <= last; i++) *out++ = text[i];
+        }
+        return out;
+    }
+
+    static const size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit FastWriter(std::ostream* sink = nullptr, size_t capacity = DEFAULT_CAPACITY)
+        : sink(sink), buffer(capacity) {}
+
+    FastWriter(const FastWriter&) = delete;
+    FastWriter& operator=(const FastWriter&) = delete;
+    FastWriter(FastWriter&& other) noexcept
+        : sink(other.sink), buffer(std::move(other.buffer)), used(other.used) {
+        other.sink = nullptr;
+        other.used = 0;
+    }
+    FastWriter& operator=(FastWriter&&) = delete;
+
+    ~FastWriter() { flush(); }
+
+    void flush() {
+        if (sink && used > 0) {
+            sink->write(buffer.data(), used);
+            used = 0;
+        }
+    }
+
+    std::string_view view() const { return std::string_view(buffer.data(), used); }
+    size_t size() const { return used; }
+    void clear() { used = 0; }
+
+    FastWriter& put(char c) {
+        *reserve(1) = c;
+        used++;
+        return *this;
+    }
+
+    FastWriter& put(std::string_view text) {
+        if (sink && text.size() > buffer.size()) {
+            // 超过整个缓冲区的大块直接写出
+            flush();
+            sink->write(text.data(), text.size());
+            return *this;
+        }
+        char* p = reserve(text.size());
+        std::copy(text.begin(), text.end(), p);
+        used += text.size();
+        return *this;
+    }
+
+    // 与 iostream 默认格式（%g，有效数字 precision 位）逐字节一致
+    FastWriter& putGeneral(double value, int precision = 6) {
+        char* p = reserve(64);
+        char* end = generalFast(p, value, precision);
+        if (!end) end = std::to_chars(p, p + 64, value, std::chars_format::general, precision).ptr;
+        used = end - buffer.data();
+        return *this;
+    }
+
+    // 与 std::fixed + setprecision(precision) 一致
+    FastWriter& putFixed(double value, int precision = 6) {
+        // fixed 格式的位数随数量级增长，double 最多 309 位整数部分
+        char* p = reserve(330 + precision);
+        used = std::to_chars(p, p + 330 + precision, value, std::chars_format::fixed, precision).ptr - buffer.data();
+        return *this;
+    }
+
+    // 最短的可精确回读表示，用于无损导出
+    FastWriter& putExact(double value) {
+        char* p = reserve(64);
+        used = std::to_chars(p, p + 64, value).ptr - buffer.data();
+        return *this;
+    }
+
+    FastWriter& putInteger(long long value) {
+        char* p = reserve(24);
+        used = std::to_chars(p, p + 24, value).ptr - buffer.data();
+        return *this;
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读内存映射文件：打开即映射整个文件，由操作系统按需调页，
+// 大文件无需读入内存也无需解析。打开失败时抛出 std::runtime_error
+class MappedFile {
+private:
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    void release() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap(const_cast<unsigned char*>(base), length);
+#endif
+        base = nullptr;
+        length = 0;
+    }
+
+public:
+    MappedFile() {}
+
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("无法打开文件: " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            release();
+            throw std::runtime_error("无法获取文件大小: " + path);
+        }
+        length = (size_t)fileSize.QuadPart;
+        if (length > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            base = mapping ? (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!base) {
+                release();
+                throw std::runtime_error("无法映射文件: " + path);
+            }
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("无法打开文件: " + path);
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("无法获取文件大小: " + path);
+        }
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                length = 0;
+                throw std::runtime_error("无法映射文件: " + path);
+            }
+            base = (const unsigned char*)p;
+        }
+        close(fd);  // 映射建立后不再需要文件描述符
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            release();
+            std::swap(base, other.base);
+            std::swap(length, other.length);
+#ifdef _WIN32
+            std::swap(file, other.file);
+            std::swap(mapping, other.mapping);
+#endif
+        }
+        return *this;
+    }
+
+    ~MappedFile() { release(); }
+
+    const unsigned char* data() const { return base; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    // 提示操作系统将按顺序读取 [offset, offset+bytes)
+    void adviseSequential(size_t offset, size_t bytes) const {
+#ifndef _WIN32
+        if (!base || offset >= length) return;
+        long page = sysconf(_SC_PAGESIZE);
+        size_t start = offset / page * page;
+        size_t end = std::min(length, offset + bytes);
+        madvise(const_cast<unsigned char*>(base) + start, end - start, MADV_SEQUENTIAL);
+#else
+        (void)offset;
+        (void)bytes;
+#endif
+    }
+
+    // 提示操作系统 [offset, offset+bytes) 已用完，可从本进程的驻留内存中移除；
+    // 之后再访问只会重新调页，内容不变
+    void adviseDone(size_t offset, size_t bytes) const {
+#ifndef _WIN32
+        if (!base || offset >= length) return;
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = (offset + page - 1) / page * page;  // 只处理完整落在区间内的页
+        size_t end = std::min(length, offset + bytes) / page * page;
+        if (start < end) madvise(const_cast<unsigned char*>(base) + start, end - start, MADV_DONTNEED);
+#else
+        (void)offset;
+        (void)bytes;
+#endif
+    }
+};
+
+#endif
@@ -4,6 +4,25 @@
 #include <algorithm>
 #include <random>
 #include <chrono>
+#include <cstdint>
+#include <utility>
+#include <span>
+#include <type_traits>
+#include <string>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <climits>
+#include "MappedFile.h"
+
+// GCC/Clang 在 x86 上按 CPU 运行时选择 AVX2 内核，其他平台只用标量版本
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MAXAREA_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -39,6 +58,566 @@ int largestRectangleArea(vector<int>& heights) {
     return maxArea;
 }
 
+// 流式计算：逐个 push 柱子高度，finish 时得到最大面积。
+// 只保存单调栈中的 (高度, 起始下标)，内存取决于栈深而不是输入长度，
+// 每根柱子均摊 O(1)；面积用 64 位计算，不会溢出
+class HistogramStream {
+private:
+    vector<pair<int64_t, uint64_t>> st;  // 高度严格递增，start 为该高度能向左延伸到的下标
+    uint64_t index = 0;
+    int64_t maxArea = 0;
+    size_t maxDepth = 0;
+
+    // 弹出所有高于 height 的柱子，返回最后弹出者的起始下标
+    uint64_t popHigher(int64_t height) {
+        uint64_t start = index;
+        while (!st.empty() && st.back().first > height) {
+            start = st.back().second;
+            maxArea = max(maxArea, st.back().first * (int64_t)(index - start));
+            st.pop_back();
+        }
+        return start;
+    }
+
+public:
+    // 高度必须非负：finish 以 -1 为哨兵清空栈，更低的高度会残留在栈中破坏下一段输入
+    void push(int64_t height) {
+        if (height < 0) throw invalid_argument("HistogramStream: heights must be non-negative");
+        uint64_t start = popHigher(height);
+        // 与栈顶等高时栈顶已覆盖这根柱子
+        if (st.empty() || st.back().first < height) {
+            st.push_back({height, start});
+            maxDepth = max(maxDepth, st.size());
+        }
+        index++;
+    }
+
+    // 结束输入，返回最大面积并重置，之后可以开始新的一段输入
+    int64_t finish() {
+        popHigher(-1);
+        int64_t result = maxArea;
+        index = 0;
+        maxArea = 0;
+        return result;
+    }
+
+    uint64_t count() const { return index; }
+    size_t stackDepth() const { return st.size(); }
+    size_t peakDepth() const { return maxDepth; }
+};
+
+// 面积类型：整数高度用 64 位整数，浮点高度用 double
+template<typename T>
+using RectArea = typename conditional<is_floating_point<T>::value, double, int64_t>::type;
+
+// 单调栈的缓冲区，可在多次调用间复用。按栈的实际深度增长而不是按输入长度预先分配
+// （随机输入的栈很浅）；输入少于 2^32 根柱子时用 32 位下标，占用减半
+struct RectStack {
+    vector<uint32_t> narrow;
+    vector<uint64_t> wide;
+
+    size_t capacityBytes() const {
+        return narrow.capacity() * sizeof(uint32_t) + wide.capacity() * sizeof(uint64_t);
+    }
+    void release() {
+        narrow = vector<uint32_t>();
+        wide = vector<uint64_t>();
+    }
+};
+
+// 不复制输入的单调栈内核：两端的 0 高度哨兵是虚拟的
+template<typename T, typename Index>
+RectArea<T> largestRectangleWith(span<const T> heights, vector<Index>& stackBuffer) {
+    typedef RectArea<T> Area;
+    size_t n = heights.size();
+    Index* st = stackBuffer.data();
+    size_t capacity = stackBuffer.size();
+    size_t top = 0;
+    Area maxArea = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        T h = heights[i];
+        while (top > 0 && h < heights[st[top - 1]]) {
+            Area height = heights[st[--top]];
+            size_t left = top > 0 ? st[top - 1] + 1 : 0;
+            maxArea = max(maxArea, height * (Area)(i - left));
+        }
+        if (top == capacity) {
+            capacity = max<size_t>(64, capacity * 2);
+            stackBuffer.resize(capacity);
+            st = stackBuffer.data();
+        }
+        st[top++] = (Index)i;
+    }
+    // 右侧虚拟哨兵：剩余的柱子都延伸到末尾
+    while (top > 0) {
+        Area height = heights[st[--top]];
+        size_t left = top > 0 ? st[top - 1] + 1 : 0;
+        maxArea = max(maxArea, height * (Area)(n - left));
+    }
+    return maxArea;
+}
+
+template<typename T>
+RectArea<T> largestRectangle(span<const T> heights, RectStack& stack) {
+    if (heights.empty()) return 0;
+    if (heights.size() <= UINT32_MAX) return largestRectangleWith(heights, stack.narrow);
+    return largestRectangleWith(heights, stack.wide);
+}
+
+// 使用线程内复用栈缓冲区的便捷版本；栈曾经很深（如单调输入）时调用后释放，
+// 不让一次大输入的缓冲区一直占着
+template<typename T>
+RectArea<T> largestRectangle(span<const T> heights) {
+    thread_local RectStack stack;
+    RectArea<T> area = largestRectangle(heights, stack);
+    if (stack.capacityBytes() > ((size_t)1 << 24)) stack.release();
+    return area;
+}
+
+// 对 [0, count) 中的每个 c 并行执行 fn(c)，每个任务一个线程
+inline void forEachParallel(size_t count, const function<void(size_t)>& fn) {
+    vector<thread> workers;
+    for (size_t c = 1; c < count; c++) workers.emplace_back(fn, c);
+    if (count > 0) fn(0);
+    for (auto& w : workers) w.join();
+}
+
+// 分块并行：把柱子分成 chunks 段，每根柱子的面积为 高 * (右侧第一个更矮者 - 左侧第一个更矮者 - 1)。
+// 段内用单调栈求最近更矮者；段内找不到的，先用各段最小值的稀疏表找到最近的、
+// 最小值更矮的段，再在该段的后缀最小值（向左找）或前缀最小值（向右找）上二分定位。
+// 结果与串行版本完全相同
+template<typename T>
+RectArea<T> largestRectangleChunked(span<const T> heights, size_t chunks) {
+    typedef RectArea<T> Area;
+    size_t n = heights.size();
+    if (n == 0) return 0;
+    chunks = max<size_t>(1, min(chunks, n));
+    size_t chunkSize = (n + chunks - 1) / chunks;
+    chunks = (n + chunkSize - 1) / chunkSize;
+    auto chunkBegin = [&](size_t c) { return c * chunkSize; };
+    auto chunkEnd = [&](size_t c) { return min(n, (c + 1) * chunkSize); };
+
+    // 第一步：各段的前缀最小值、后缀最小值与段最小值
+    vector<T> prefixMin(n), suffixMin(n), chunkMin(chunks);
+    forEachParallel(chunks, [&](size_t c) {
+        size_t b = chunkBegin(c), e = chunkEnd(c);
+        prefixMin[b] = heights[b];
+        for (size_t i = b + 1; i < e; i++) prefixMin[i] = min(prefixMin[i - 1], heights[i]);
+        suffixMin[e - 1] = heights[e - 1];
+        for (size_t i = e - 1; i-- > b;) suffixMin[i] = min(suffixMin[i + 1], heights[i]);
+        chunkMin[c] = prefixMin[e - 1];
+    });
+
+    // 第二步：段最小值的稀疏表，table[k][c] = min(chunkMin[c .. c + 2^k))
+    vector<vector<T>> table(1, chunkMin);
+    for (size_t k = 1; (size_t(1) << k) <= chunks; k++) {
+        const vector<T>& prev = table[k - 1];
+        vector<T> level(chunks - (size_t(1) << k) + 1);
+        for (size_t c = 0; c < level.size(); c++) level[c] = min(prev[c], prev[c + (size_t(1) << (k - 1))]);
+        table.push_back(move(level));
+    }
+
+    // c 左侧最近的、段最小值小于 h 的段，没有时返回 -1
+    auto leftChunk = [&](size_t c, T h) -> long long {
+        long long pos = (long long)c - 1;  // 不变式：(pos, c) 内的段最小值都 >= h
+        for (size_t k = table.size(); k-- > 0;) {
+            long long span = (long long)1 << k;
+            if (pos - span + 1 >= 0 && table[k][pos - span + 1] >= h) pos -= span;
+        }
+        return pos;
+    };
+    // c 右侧最近的、段最小值小于 h 的段，没有时返回 chunks
+    auto rightChunk = [&](size_t c, T h) -> size_t {
+        size_t pos = c + 1;
+        for (size_t k = table.size(); k-- > 0;) {
+            size_t span = size_t(1) << k;
+            if (pos + span <= chunks && table[k][pos] >= h) pos += span;
+        }
+        return pos;
+    };
+    // 段 c 中下标最大的、高度小于 h 的柱子（后缀最小值单调不减，可二分）
+    auto lastSmaller = [&](size_t c, T h) {
+        size_t lo = chunkBegin(c), hi = chunkEnd(c);  // 答案在 [lo, hi) 内
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (suffixMin[mid] < h) lo = mid; else hi = mid;
+        }
+        return lo;
+    };
+    // 段 c 中下标最小的、高度小于 h 的柱子（前缀最小值单调不增，可二分）
+    auto firstSmaller = [&](size_t c, T h) {
+        size_t lo = chunkBegin(c), hi = chunkEnd(c) - 1;  // 答案在 [lo, hi] 内
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (prefixMin[mid] < h) hi = mid; else lo = mid + 1;
+        }
+        return lo;
+    };
+
+    // 第三步：各段独立求左右边界与最大面积
+    vector<Area> best(chunks, 0);
+    forEachParallel(chunks, [&](size_t c) {
+        size_t b = chunkBegin(c), e = chunkEnd(c);
+        vector<size_t> left(e - b);  // 左侧第一个更矮者的下标 + 1，即矩形左端
+        vector<size_t> st;
+        for (size_t i = b; i < e; i++) {
+            while (!st.empty() && heights[st.back()] >= heights[i]) st.pop_back();
+            if (!st.empty()) {
+                left[i - b] = st.back() + 1;
+            } else {
+                long long lc = leftChunk(c, heights[i]);
+                left[i - b] = lc < 0 ? 0 : lastSmaller((size_t)lc, heights[i]) + 1;
+            }
+            st.push_back(i);
+        }
+        st.clear();
+        Area chunkBest = 0;
+        for (size_t i = e; i-- > b;) {
+            while (!st.empty() && heights[st.back()] >= heights[i]) st.pop_back();
+            size_t right;
+            if (!st.empty()) {
+                right = st.back();
+            } else {
+                size_t rc = rightChunk(c, heights[i]);
+                right = rc >= chunks ? n : firstSmaller(rc, heights[i]);
+            }
+            st.push_back(i);
+            chunkBest = max(chunkBest, (Area)heights[i] * (Area)(right - left[i - b]));
+        }
+        best[c] = chunkBest;
+    });
+    return *max_element(best.begin(), best.end());
+}
+
+// 多核版本：输入较小时直接串行
+template<typename T>
+RectArea<T> largestRectangleParallel(span<const T> heights, unsigned threads = thread::hardware_concurrency()) {
+    const size_t minChunk = 1 << 16;
+    size_t chunks = min<size_t>(max(1u, threads), heights.size() / minChunk);
+    if (chunks <= 1) return largestRectangle(heights);
+    return largestRectangleChunked(heights, chunks);
+}
+
+// 二维最大矩形：矩阵按行优先存放，每格一个字节，值 >= threshold 的格子视为可用
+// （二值图像取 threshold = 1）。逐行累加每列向上连续可用的格数，
+// 每一行的高度数组就是一个直方图，交给 largestRectangle 求解
+
+// heights[j] = row[j] >= threshold ? heights[j] + 1 : 0
+void updateRowHeightsScalar(uint32_t* heights, const uint8_t* row, size_t cols, uint8_t threshold) {
+    for (size_t j = 0; j < cols; j++) {
+        uint32_t keep = 0u - (uint32_t)(row[j] >= threshold);
+        heights[j] = (heights[j] + 1) & keep;
+    }
+}
+
+#ifdef MAXAREA_AVX2_DISPATCH
+__attribute__((target("avx2")))
+void updateRowHeightsAvx2(uint32_t* heights, const uint8_t* row, size_t cols, uint8_t threshold) {
+    if (threshold == 0) {  // 所有格子都可用，下面的 threshold - 1 比较不适用
+        updateRowHeightsScalar(heights, row, cols, threshold);
+        return;
+    }
+    const __m256i limit = _mm256_set1_epi32((int)threshold - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    size_t j = 0;
+    for (; j + 8 <= cols; j += 8) {
+        __m256i cells = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(row + j)));
+        __m256i keep = _mm256_cmpgt_epi32(cells, limit);
+        __m256i h = _mm256_loadu_si256((const __m256i*)(heights + j));
+        _mm256_storeu_si256((__m256i*)(heights + j), _mm256_and_si256(_mm256_add_epi32(h, one), keep));
+    }
+    updateRowHeightsScalar(heights + j, row + j, cols - j, threshold);
+}
+
+bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+void updateRowHeights(uint32_t* heights, const uint8_t* row, size_t cols, uint8_t threshold) {
+#ifdef MAXAREA_AVX2_DISPATCH
+    if (cpuHasAvx2()) {
+        updateRowHeightsAvx2(heights, row, cols, threshold);
+        return;
+    }
+#endif
+    updateRowHeightsScalar(heights, row, cols, threshold);
+}
+
+// 每处理完这么多行，通知调用方这些行已不再需要
+const size_t MATRIX_BLOCK_ROWS = 64;
+
+// 多核版本：按行切成水平带，每个线程一带。
+// 第一遍各带从全 0 开始只更新高度，带底的高度即该带底部每列连续可用的格数；
+// 串行地把它们逐带累加成每带的初始高度（整列可用时接上方的高度）；
+// 第二遍各带以此为初始高度逐行求直方图最大矩形，因此跨带的矩形也能找到。
+// 每个线程只占用一行高度和一个栈；doneRows(begin, end) 在这些行两遍都读完后调用
+int64_t maximalRectangle(const uint8_t* cells, size_t rows, size_t cols, uint8_t threshold = 1,
+                         unsigned threads = thread::hardware_concurrency(),
+                         const function<void(size_t, size_t)>& doneRows = nullptr) {
+    if (rows == 0 || cols == 0) return 0;
+    size_t bands = min<size_t>(max(1u, threads), (rows + MATRIX_BLOCK_ROWS - 1) / MATRIX_BLOCK_ROWS);
+    size_t bandRows = (rows + bands - 1) / bands;
+    bands = (rows + bandRows - 1) / bandRows;
+    auto bandBegin = [&](size_t b) { return b * bandRows; };
+    auto bandEnd = [&](size_t b) { return min(rows, (b + 1) * bandRows); };
+
+    // 第一遍：seeds[b + 1] 先存第 b 带底部的连续可用格数
+    vector<vector<uint32_t>> seeds(bands);
+    seeds[0].assign(cols, 0);
+    if (bands > 1) {
+        forEachParallel(bands - 1, [&](size_t b) {
+            vector<uint32_t>& heights = seeds[b + 1];
+            heights.assign(cols, 0);
+            for (size_t i = bandBegin(b); i < bandEnd(b); i++) updateRowHeights(heights.data(), cells + i * cols, cols, threshold);
+        });
+        for (size_t b = 1; b < bands; b++) {
+            uint32_t full = (uint32_t)(bandEnd(b - 1) - bandBegin(b - 1));
+            for (size_t j = 0; j < cols; j++) {
+                if (seeds[b][j] == full) seeds[b][j] += seeds[b - 1][j];
+            }
+        }
+    }
+
+    // 第二遍：各带从自己的初始高度出发逐行求解
+    vector<int64_t> best(bands, 0);
+    forEachParallel(bands, [&](size_t b) {
+        vector<uint32_t> heights = move(seeds[b]);
+        RectStack stackBuffer;
+        int64_t bandBest = 0;
+        size_t blockBegin = bandBegin(b);
+        for (size_t i = bandBegin(b); i < bandEnd(b); i++) {
+            updateRowHeights(heights.data(), cells + i * cols, cols, threshold);
+            bandBest = max(bandBest, largestRectangle<uint32_t>(heights, stackBuffer));
+            if (doneRows && (i + 1 - blockBegin == MATRIX_BLOCK_ROWS || i + 1 == bandEnd(b))) {
+                doneRows(blockBegin, i + 1);
+                blockBegin = i + 1;
+            }
+        }
+        best[b] = bandBest;
+    });
+    return *max_element(best.begin(), best.end());
+}
+
+// 从文件读取的版本：文件是 rows * cols 字节的行优先矩阵，由内存映射按需调页，
+// 处理完的行随即从驻留内存中释放，超过内存的大矩阵也能处理
+int64_t maximalRectangleFile(const string& path, size_t cols, uint8_t threshold = 1,
+                             unsigned threads = thread::hardware_concurrency()) {
+    if (cols == 0) throw invalid_argument("maximalRectangleFile: cols must be positive");
+    MappedFile file(path);
+    if (file.size() % cols != 0) throw invalid_argument("maximalRectangleFile: file size is not a multiple of cols");
+    size_t rows = file.size() / cols;
+    file.adviseSequential(0, file.size());
+    return maximalRectangle(file.data(), rows, cols, threshold, threads,
+                            [&](size_t begin, size_t end) { file.adviseDone(begin * cols, (end - begin) * cols); });
+}
+
+// 一组直线 y = slope * t + intercept 的区间最大值（kinetic segment tree）。
+// 时间 t 只增不减：每个结点保存当前时刻的最优直线，以及子树内最早可能换成另一条直线的时刻 melt，
+// 推进时间时只重算 melt 已到的结点
+class KineticMax {
+private:
+    struct Line {
+        int64_t slope, intercept;
+        int64_t at(int64_t t) const { return slope * t + intercept; }
+    };
+    static constexpr int64_t EMPTY = INT64_MIN / 4;  // 空位置，斜率为 0，永远不会胜出
+    static constexpr int64_t NEVER = INT64_MAX;
+
+    size_t leaves = 1;
+    vector<Line> best;
+    vector<int64_t> melt;
+    int64_t now;
+
+    void pull(size_t node) {
+        const Line& a = best[2 * node];
+        const Line& b = best[2 * node + 1];
+        int64_t va = a.at(now), vb = b.at(now);
+        bool leftWins = va > vb || (va == vb && a.slope >= b.slope);
+        const Line& winner = leftWins ? a : b;
+        const Line& loser = leftWins ? b : a;
+        int64_t nextMelt = min(melt[2 * node], melt[2 * node + 1]);
+        if (loser.slope > winner.slope) {  // 斜率更大的一方迟早反超
+            int64_t gap = winner.at(now) - loser.at(now);
+            nextMelt = min(nextMelt, now + gap / (loser.slope - winner.slope) + 1);
+        }
+        best[node] = winner;
+        melt[node] = nextMelt;
+    }
+
+    void advance(size_t node) {
+        if (melt[node] > now) return;
+        advance(2 * node);
+        advance(2 * node + 1);
+        pull(node);
+    }
+
+public:
+    KineticMax(size_t size, int64_t start) : now(start) {
+        while (leaves < size) leaves *= 2;
+        best.assign(2 * leaves, Line{0, EMPTY});
+        melt.assign(2 * leaves, NEVER);
+    }
+
+    void set(size_t i, int64_t slope, int64_t intercept) {
+        size_t node = i + leaves;
+        best[node] = Line{slope, intercept};
+        for (node /= 2; node >= 1; node /= 2) pull(node);
+    }
+
+    void clear(size_t i) { set(i, 0, EMPTY); }
+
+    void advanceTo(int64_t t) {
+        now = t;
+        advance(1);
+    }
+
+    // [lo, hi) 内直线在当前时刻的最大值，区间为空时返回 EMPTY
+    int64_t maxValue(size_t lo, size_t hi) const {
+        int64_t result = EMPTY;
+        for (lo += leaves, hi += leaves; lo < hi; lo /= 2, hi /= 2) {
+            if (lo & 1) result = max(result, best[lo++].at(now));
+            if (hi & 1) result = max(result, best[--hi].at(now));
+        }
+        return result;
+    }
+};
+
+// 子区间最大矩形的批量查询：对同一个直方图反复询问 [l, r] 窗口内的最大矩形。
+// 设 m 为窗口内最左的最小值，答案为 高[m] * 窗口宽 与 [l, m-1]、[m+1, r] 两侧答案的最大者。
+// 以 parent[i] = 左侧最近的不高于 i 的柱子建树（笛卡尔树的一条边界链），从 r 沿 parent 上行到 m
+// 的链把 [m+1, r] 分成链上结点 q 与间隙 (parent[q], q)：q 贡献 高[q] * (r - parent[q])，
+// 间隙内的最大矩形 inner[q] 建树时一并求出。左侧在反转后的数组上同样处理。
+// 查询离线按右端点排序后扫描，扫描到 r 时单调栈恰好就是这条链，栈中每个位置的贡献
+// 是关于 r 的直线，用 KineticMax 求栈顶一段的最大值；查询分组后各组独立扫描，可以并行
+class RangeRectangleIndex {
+private:
+    // 一个方向上的链：parent 没有时为 -1，depth 为在单调栈中的位置
+    struct Side {
+        vector<int> heights;
+        vector<int64_t> parent;
+        vector<uint32_t> depth;
+        vector<int64_t> inner;
+
+        void build(vector<int> h) {
+            heights = move(h);
+            size_t n = heights.size();
+            parent.resize(n);
+            depth.resize(n);
+            inner.resize(n);
+            vector<size_t> st;
+            for (size_t x = 0; x < n; x++) {
+                // 被弹出的柱子正好填满间隙 (parent[x], x)，它们各自的完整矩形都在间隙内
+                int64_t gapBest = 0;
+                while (!st.empty() && heights[st.back()] > heights[x]) {
+                    size_t q = st.back();
+                    st.pop_back();
+                    gapBest = max({gapBest, inner[q], (int64_t)heights[q] * ((int64_t)x - 1 - parent[q])});
+                }
+                inner[x] = gapBest;
+                parent[x] = st.empty() ? -1 : (int64_t)st.back();
+                depth[x] = (uint32_t)st.size();
+                st.push_back(x);
+            }
+        }
+
+        // 按时刻排好序的 (时刻, 查询) 中 [begin, end) 一段：从第一个时刻扫描到最后一个时刻，
+        // 每到一个时刻 x，对其中的查询调用 visit(查询, 栈中各层的柱子下标, 栈)
+        template<typename Visit>
+        void sweep(const vector<pair<size_t, size_t>>& items, size_t begin, size_t end, Visit visit) const {
+            size_t first = items[begin].first, last = items[end - 1].first;
+            uint32_t maxDepth = *max_element(depth.begin() + first, depth.begin() + last + 1);
+            KineticMax lines(2 * ((size_t)maxDepth + 1), (int64_t)first);
+            vector<size_t> stackPos(maxDepth + 1);
+            // 每层两个位置：链上结点的直线与其间隙内的最大值
+            auto place = [&](size_t q) {
+                stackPos[depth[q]] = q;
+                lines.set(2 * depth[q], heights[q], -(int64_t)heights[q] * parent[q]);
+                lines.set(2 * depth[q] + 1, 0, inner[q]);
+            };
+            for (int64_t q = (int64_t)first; q >= 0; q = parent[q]) place((size_t)q);
+
+            size_t k = begin;
+            for (size_t x = first; x <= last; x++) {
+                if (x > first) {
+                    for (uint32_t level = depth[x] + 1; level <= depth[x - 1]; level++) {
+                        lines.clear(2 * level);
+                        lines.clear(2 * level + 1);
+                    }
+                    place(x);
+                    lines.advanceTo((int64_t)x);
+                }
+                for (; k < end && items[k].first == x; k++) visit(items[k].second, stackPos, lines);
+            }
+        }
+    };
+
+    Side forward, backward;  // backward 建在反转后的数组上
+
+    // 把按时刻排好序的查询分成 groups 段并行扫描
+    template<typename Visit>
+    static void sweepGroups(const Side& side, vector<pair<size_t, size_t>>& items, size_t groups, Visit visit) {
+        if (items.empty()) return;
+        sort(items.begin(), items.end());
+        groups = max<size_t>(1, min(groups, items.size()));
+        size_t per = (items.size() + groups - 1) / groups;
+        groups = (items.size() + per - 1) / per;
+        forEachParallel(groups, [&](size_t g) {
+            side.sweep(items, g * per, min(items.size(), (g + 1) * per), visit);
+        });
+    }
+
+public:
+    explicit RangeRectangleIndex(const vector<int>& heights) {
+        for (int h : heights) {
+            if (h < 0) throw invalid_argument("RangeRectangleIndex: heights must be non-negative");
+        }
+        forward.build(heights);
+        backward.build(vector<int>(heights.rbegin(), heights.rend()));
+    }
+
+    size_t size() const { return forward.heights.size(); }
+
+    // 批量回答 [l, r]（闭区间）窗口内的最大矩形面积，结果与输入顺序一致
+    vector<int64_t> query(const vector<pair<size_t, size_t>>& windows,
+                          unsigned threads = thread::hardware_concurrency()) const {
+        size_t n = size();
+        for (const auto& [l, r] : windows) {
+            if (l > r || r >= n) throw out_of_range("RangeRectangleIndex: invalid window");
+        }
+        vector<int64_t> answers(windows.size());
+        vector<size_t> minimum(windows.size());
+
+        // 第一遍按 r 扫描：栈中第一个下标 >= l 的柱子就是窗口内最左的最小值
+        vector<pair<size_t, size_t>> items;
+        items.reserve(windows.size());
+        for (size_t i = 0; i < windows.size(); i++) items.emplace_back(windows[i].second, i);
+        sweepGroups(forward, items, threads, [&](size_t i, const vector<size_t>& stackPos, const KineticMax& lines) {
+            auto [l, r] = windows[i];
+            size_t top = forward.depth[r];
+            size_t level = lower_bound(stackPos.begin(), stackPos.begin() + top + 1, l) - stackPos.begin();
+            size_t m = stackPos[level];
+            minimum[i] = m;
+            answers[i] = (int64_t)forward.heights[m] * (int64_t)(r - l + 1);
+            if (m < r) answers[i] = max(answers[i], lines.maxValue(2 * (level + 1), 2 * (top + 1)));
+        });
+
+        // 第二遍在反转数组上按 n-1-l 扫描，处理 [l, m-1]
+        items.clear();
+        for (size_t i = 0; i < windows.size(); i++) {
+            if (minimum[i] > windows[i].first) items.emplace_back(n - 1 - windows[i].first, i);
+        }
+        sweepGroups(backward, items, threads, [&](size_t i, const vector<size_t>&, const KineticMax& lines) {
+            size_t anchor = n - 1 - minimum[i], right = n - 1 - windows[i].first;
+            answers[i] = max(answers[i], lines.maxValue(2 * ((size_t)backward.depth[anchor] + 1),
+                                                         2 * ((size_t)backward.depth[right] + 1)));
+        });
+        return answers;
+    }
+};
+
 void testExamples() {
 
     vector<int> heights1 = {2, 1, 5, 6, 2, 3};
@@ -116,9 +695,322 @@ void testEdgeCases() {
     cout << "递减序列[5,4,3,2,1]: " << largestRectangleArea(decreasing) << endl;
 }
 
-int main() {
+void testKernel() {
+    cout << "\n模板内核测试:" << endl;
+
+    mt19937 gen(7);
+    uniform_int_distribution<> lengthDist(0, 200);
+    uniform_int_distribution<> heightDist(0, 1000);
+    RectStack stackBuffer;
+    bool allMatch = true;
+    for (int t = 0; t < 1000; t++) {
+        vector<int> heights(lengthDist(gen));
+        for (int& h : heights) h = heightDist(gen);
+        vector<int64_t> wide(heights.begin(), heights.end());
+        vector<float> real(heights.begin(), heights.end());
+        int64_t expected = largestRectangleArea(heights);
+        allMatch = allMatch && largestRectangle<int>(heights, stackBuffer) == expected &&
+                   largestRectangle<int64_t>(wide) == expected &&
+                   largestRectangle<float>(real) == (double)expected;
+    }
+    cout << "int32/int64/float 与 largestRectangleArea 一致: " << (allMatch ? "是" : "否") << endl;
+
+    // 面积 3e9 超出 int 范围，原函数在此会溢出
+    vector<int> big(3000000, 1000);
+    cout << "3e6 根高 1000 的柱子: " << largestRectangle<int>(big) << endl;
+
+    vector<float> fractional = {0.5f, 2.5f, 2.25f, 0.75f};
+    cout << "浮点高度[0.5,2.5,2.25,0.75]: " << largestRectangle<float>(fractional) << endl;
+}
+
+// 参考实现：逐行累加高度后调用原函数
+int maximalRectangleReference(const vector<uint8_t>& cells, size_t rows, size_t cols, uint8_t threshold) {
+    vector<int> heights(cols, 0);
+    int best = 0;
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) heights[j] = cells[i * cols + j] >= threshold ? heights[j] + 1 : 0;
+        best = max(best, largestRectangleArea(heights));
+    }
+    return best;
+}
+
+// 参考实现：把窗口复制出来再调用原函数
+vector<int64_t> bruteRangeQueries(const vector<int>& heights, const vector<pair<size_t, size_t>>& windows) {
+    vector<int64_t> answers;
+    for (const auto& [l, r] : windows) {
+        vector<int> window(heights.begin() + l, heights.begin() + r + 1);
+        answers.push_back(largestRectangleArea(window));
+    }
+    return answers;
+}
+
+// 原函数与模板内核的耗时对比
+void runBenchmark(size_t maxBars) {
+    cout << "性能对比:" << endl;
+    mt19937 gen(99);
+    uniform_int_distribution<> heightDist(0, 1000000);
+    RectStack stackBuffer;
+    for (size_t n = 1000000; n <= maxBars; n *= 10) {
+        vector<int> heights(n);
+        for (int& h : heights) h = heightDist(gen);
+
+        auto start = chrono::high_resolution_clock::now();
+        int original = largestRectangleArea(heights);
+        auto end = chrono::high_resolution_clock::now();
+        double originalTime = chrono::duration<double, milli>(end - start).count();
+
+        start = chrono::high_resolution_clock::now();
+        int64_t kernel = largestRectangle<int>(heights, stackBuffer);
+        end = chrono::high_resolution_clock::now();
+        double kernelTime = chrono::duration<double, milli>(end - start).count();
+
+        vector<float> real(heights.begin(), heights.end());
+        start = chrono::high_resolution_clock::now();
+        double realArea = largestRectangle<float>(real, stackBuffer);
+        end = chrono::high_resolution_clock::now();
+        double realTime = chrono::duration<double, milli>(end - start).count();
+
+        cout << "  n = " << n << ": largestRectangleArea " << originalTime << " 毫秒 (" << original
+             << "), largestRectangle<int> " << kernelTime << " 毫秒 (" << kernel << "), 加速比 "
+             << originalTime / kernelTime << "x, float " << realTime << " 毫秒 (" << (int64_t)realArea << ")" << endl;
+
+        unsigned threads = max(1u, thread::hardware_concurrency());
+        start = chrono::high_resolution_clock::now();
+        int64_t parallel = largestRectangleParallel<int>(heights, threads);
+        end = chrono::high_resolution_clock::now();
+        double parallelTime = chrono::duration<double, milli>(end - start).count();
+        cout << "    分块并行 (" << threads << " 线程) " << parallelTime << " 毫秒, 相对串行内核 "
+             << kernelTime / parallelTime << "x" << (parallel == kernel ? "" : " [结果不一致]") << endl;
+    }
+
+    // 二维：8000x8000 二值矩阵，约 90% 为 1
+    size_t side = 8000;
+    vector<uint8_t> cells(side * side);
+    uniform_int_distribution<> cellDist(0, 9);
+    for (uint8_t& c : cells) c = cellDist(gen) != 0;
+    auto start = chrono::high_resolution_clock::now();
+    int reference = maximalRectangleReference(cells, side, side, 1);
+    auto end = chrono::high_resolution_clock::now();
+    double referenceTime = chrono::duration<double, milli>(end - start).count();
+    start = chrono::high_resolution_clock::now();
+    int64_t single = maximalRectangle(cells.data(), side, side, 1, 1);
+    end = chrono::high_resolution_clock::now();
+    double singleTime = chrono::duration<double, milli>(end - start).count();
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    start = chrono::high_resolution_clock::now();
+    int64_t parallel = maximalRectangle(cells.data(), side, side, 1, threads);
+    end = chrono::high_resolution_clock::now();
+    double parallelTime = chrono::duration<double, milli>(end - start).count();
+    cout << "  " << side << "x" << side << " 二值矩阵: 逐行 largestRectangleArea " << referenceTime << " 毫秒 ("
+         << reference << "), maximalRectangle 单线程 " << singleTime << " 毫秒 (" << single << "), "
+         << threads << " 线程 " << parallelTime << " 毫秒 (" << parallel << ")" << endl;
+
+    // 子区间批量查询：1e6 根柱子上 2000 个随机窗口
+    vector<int> bars(1000000);
+    for (int& h : bars) h = heightDist(gen);
+    uniform_int_distribution<size_t> posDist(0, bars.size() - 1);
+    vector<pair<size_t, size_t>> windows;
+    for (int k = 0; k < 2000; k++) {
+        size_t a = posDist(gen), b = posDist(gen);
+        windows.emplace_back(min(a, b), max(a, b));
+    }
+    start = chrono::high_resolution_clock::now();
+    vector<int64_t> brute = bruteRangeQueries(bars, windows);
+    end = chrono::high_resolution_clock::now();
+    double bruteTime = chrono::duration<double, milli>(end - start).count();
+    start = chrono::high_resolution_clock::now();
+    RangeRectangleIndex index(bars);
+    end = chrono::high_resolution_clock::now();
+    double buildTime = chrono::duration<double, milli>(end - start).count();
+    start = chrono::high_resolution_clock::now();
+    vector<int64_t> answers = index.query(windows, threads);
+    end = chrono::high_resolution_clock::now();
+    double queryTime = chrono::duration<double, milli>(end - start).count();
+    cout << "  1e6 根柱子 2000 个窗口: 逐窗口复制计算 " << bruteTime << " 毫秒, 建索引 " << buildTime
+         << " 毫秒, 批量查询 " << queryTime << " 毫秒" << (answers == brute ? "" : " [结果不一致]") << endl;
+}
+
+void testParallel() {
+    cout << "\n分块并行测试:" << endl;
+
+    // 强制切成很多小段，覆盖跨段查找的各种情况
+    mt19937 gen(11);
+    uniform_int_distribution<> lengthDist(1, 3000);
+    bool allMatch = true;
+    for (int t = 0; t < 300; t++) {
+        uniform_int_distribution<> heightDist(0, t % 3 == 0 ? 5 : 100000);  // 含大量相等高度
+        vector<int> heights(lengthDist(gen));
+        for (int& h : heights) h = heightDist(gen);
+        int64_t expected = largestRectangle<int>(heights);
+        for (size_t chunks : {2, 3, 7, 16, 61}) {
+            allMatch = allMatch && largestRectangleChunked<int>(heights, chunks) == expected;
+        }
+    }
+    cout << "300 组随机输入、2~61 段与串行结果一致: " << (allMatch ? "是" : "否") << endl;
+
+    vector<int> increasing(200000), valley(200000);
+    for (int i = 0; i < 200000; i++) {
+        increasing[i] = i;
+        valley[i] = abs(100000 - i);
+    }
+    cout << "递增序列: " << largestRectangleChunked<int>(increasing, 8) << " / " << largestRectangle<int>(increasing)
+         << ", V 形序列: " << largestRectangleChunked<int>(valley, 8) << " / " << largestRectangle<int>(valley) << endl;
+}
+
+void testMatrix() {
+    cout << "\n二维最大矩形测试:" << endl;
+
+    // 经典示例：最大全 1 矩形面积为 6
+    vector<uint8_t> example = {1, 0, 1, 0, 0,
+                               1, 0, 1, 1, 1,
+                               1, 1, 1, 1, 1,
+                               1, 0, 0, 1, 0};
+    cout << "4x5 二值矩阵: " << maximalRectangle(example.data(), 4, 5) << endl;
+
+    // 随机矩阵与参考实现对比，行数足够多以切出多个水平带
+    mt19937 gen(5);
+    uniform_int_distribution<> sizeDist(1, 700);
+    uniform_int_distribution<> cellDist(0, 255);
+    bool allMatch = true;
+    for (int t = 0; t < 60; t++) {
+        size_t rows = sizeDist(gen), cols = sizeDist(gen) / 7 + 1;
+        uint8_t threshold = (uint8_t)(t % 4 == 0 ? 1 : cellDist(gen) / 8);  // 低阈值时会出现很高的列
+        vector<uint8_t> cells(rows * cols);
+        for (uint8_t& c : cells) c = (uint8_t)(t % 4 == 0 ? cellDist(gen) % 5 != 0 : cellDist(gen));
+        int expected = maximalRectangleReference(cells, rows, cols, threshold);
+        for (unsigned threads : {1u, 2u, 3u, 8u}) {
+            allMatch = allMatch && maximalRectangle(cells.data(), rows, cols, threshold, threads) == expected;
+        }
+    }
+    cout << "60 组随机矩阵、1~8 线程与参考实现一致: " << (allMatch ? "是" : "否") << endl;
+
+    // 从文件映射读取
+    const string dataFile = "maxarea_matrix.bin";
+    size_t rows = 2000, cols = 3000;
+    vector<uint8_t> cells(rows * cols);
+    for (uint8_t& c : cells) c = (uint8_t)cellDist(gen);
+    {
+        ofstream out(dataFile, ios::binary);
+        out.write((const char*)cells.data(), cells.size());
+    }
+    cout << "2000x3000 高度图文件 (阈值 16): " << maximalRectangleFile(dataFile, cols, 16, 4) << " / "
+         << maximalRectangleReference(cells, rows, cols, 16) << endl;
+    try {
+        maximalRectangleFile(dataFile, 7);
+    } catch (const invalid_argument& e) {
+        cout << "列数不整除文件大小: " << e.what() << endl;
+    }
+    remove(dataFile.c_str());
+}
+
+void testRangeQueries() {
+    cout << "\n子区间查询测试:" << endl;
+
+    vector<int> heights = {2, 1, 5, 6, 2, 3};
+    RangeRectangleIndex index(heights);
+    vector<int64_t> answers = index.query({{0, 5}, {2, 3}, {2, 5}, {4, 5}, {1, 1}});
+    cout << "[2,1,5,6,2,3] 的窗口 [0,5] [2,3] [2,5] [4,5] [1,1]:";
+    for (int64_t a : answers) cout << " " << a;
+    cout << endl;
+
+    // 随机直方图的全部或随机窗口与逐窗口调用原函数对比
+    mt19937 gen(17);
+    uniform_int_distribution<> lengthDist(1, 300);
+    bool allMatch = true;
+    for (int t = 0; t < 200; t++) {
+        uniform_int_distribution<> heightDist(0, t % 2 == 0 ? 4 : 1000);  // 含大量相等高度
+        vector<int> h(lengthDist(gen));
+        for (int& x : h) x = heightDist(gen);
+        if (t % 10 == 0) sort(h.begin(), h.end());  // 单调序列的链最长
+        vector<pair<size_t, size_t>> windows;
+        if (h.size() <= 40) {
+            for (size_t l = 0; l < h.size(); l++) {
+                for (size_t r = l; r < h.size(); r++) windows.emplace_back(l, r);
+            }
+        } else {
+            uniform_int_distribution<size_t> posDist(0, h.size() - 1);
+            for (int k = 0; k < 300; k++) {
+                size_t a = posDist(gen), b = posDist(gen);
+                windows.emplace_back(min(a, b), max(a, b));
+            }
+        }
+        RangeRectangleIndex randomIndex(h);
+        vector<int64_t> expected = bruteRangeQueries(h, windows);
+        for (unsigned threads : {1u, 3u, 8u}) {
+            allMatch = allMatch && randomIndex.query(windows, threads) == expected;
+        }
+    }
+    cout << "200 个随机直方图、1~8 线程与逐窗口 largestRectangleArea 一致: " << (allMatch ? "是" : "否") << endl;
+
+    try {
+        index.query({{3, 6}});
+    } catch (const out_of_range& e) {
+        cout << "越界窗口: " << e.what() << endl;
+    }
+}
+
+void testStreaming() {
+    cout << "\n流式计算测试:" << endl;
+
+    // 与 largestRectangleArea 对比
+    mt19937 gen(2024);
+    uniform_int_distribution<> lengthDist(0, 200);
+    uniform_int_distribution<> heightDist(0, 1000);
+    HistogramStream stream;
+    bool allMatch = true;
+    for (int t = 0; t < 1000; t++) {
+        vector<int> heights(lengthDist(gen));
+        for (int& h : heights) {
+            h = heightDist(gen);
+            stream.push(h);
+        }
+        allMatch = allMatch && stream.finish() == largestRectangleArea(heights);
+    }
+    cout << "1000 组随机输入与 largestRectangleArea 一致: " << (allMatch ? "是" : "否") << endl;
+
+    // 负高度被拒绝，已推入的柱子不受影响
+    stream.push(3);
+    stream.push(4);
+    bool rejected = false;
+    try {
+        stream.push(-2);
+    } catch (const invalid_argument&) {
+        rejected = true;
+    }
+    stream.push(5);
+    int64_t afterReject = stream.finish();
+    cout << "负高度被拒绝: " << (rejected ? "是" : "否") << ", 之后的结果正确: "
+         << (afterReject == 9 ? "是" : "否") << endl;
+
+    // 不保存输入的长序列：高度在 [0, 1e6) 内随机，面积超出 int 范围
+    const uint64_t bars = 50000000;
+    uniform_int_distribution<int64_t> bigDist(500000, 999999);
+    auto start = chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < bars; i++) {
+        stream.push(bigDist(gen));
+    }
+    int64_t area = stream.finish();
+    auto end = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+    cout << bars << " 根柱子的流: 最大面积 " << area << ", 栈深峰值 " << stream.peakDepth()
+         << ", 用时 " << duration.count() << " 毫秒" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    // MaxArea --bench [最大柱数]：只运行性能对比
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        size_t maxBars = argc > 2 ? stoull(argv[2]) : 100000000;
+        runBenchmark(maxBars);
+        return 0;
+    }
+
     testExamples();
     runTests();
     testEdgeCases();
+    testKernel();
+    testParallel();
+    testMatrix();
+    testRangeQueries();
+    testStreaming();
     return 0;
 }
\ No newline at end of file
@@ -1,20 +1,99 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cmath>
 #include <cctype>
 #include <stdexcept>
 #include <functional>
 #include <map>
+#include <tuple>
+#include <bit>
 #include <iomanip>
+#include <charconv>
+#include <chrono>
+#include <span>
+#include <cstdint>
+#include <limits>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+#include "FastWriter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CALC_AVX2_DISPATCH 1
+#endif
+
+// x86-64 上启用本地代码后端
+#if defined(__x86_64__) || defined(_M_X64)
+#define CALC_JIT_X64 1
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// 全局堆分配计数，用于验证稳态求值不分配内存。替换全局 operator new 会让每次分配
+// 多一次原子操作（包括 --bulk 的线程池），因此只在用 -DCALC_COUNT_ALLOCATIONS 编译时启用
+#ifdef CALC_COUNT_ALLOCATIONS
+std::atomic<size_t> heapAllocationCount{0};
+
+// 分配与释放都不内联，避免编译器把 malloc/free 与内建的 new/delete 配对后误报
+#if defined(__GNUC__)
+#define CALC_NOINLINE __attribute__((noinline))
+#else
+#define CALC_NOINLINE
+#endif
+
+CALC_NOINLINE void* operator new(std::size_t size) {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+CALC_NOINLINE void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+CALC_NOINLINE void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
 #define N_OPTR 9 
 typedef enum {ADD, SUB, MUL, DIV, POW, FAC, L_P, R_P, EOE} Operator; 
 
+// 编译后程序的指令码：OP_ADD 到 OP_FACDIV 为二元运算，其后为一元运算、取数与函数。
+// OP_FACDIV 计算 a!/b!，由编译器把两个阶乘相除合并而来，arg 为左边 '!' 的源位置；
+// OP_NOP 是合并时留下的空位，只在编译过程中出现，编译结束前统一删除
+typedef enum {
+    OP_CONST, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_FACDIV, OP_FAC, OP_NEG, OP_VAR,
+    OP_LOAD, OP_STORE,
+    OP_SIN, OP_COS, OP_TAN, OP_LOG, OP_LN, OP_SQRT, OP_ABS,
+    OP_NOP
+} OpCode;
+
 const char operChar[N_OPTR] = {'+', '-', '*', '/', '^', '!', '(', ')', '\0'};
 
 const char pri[N_OPTR][N_OPTR] = {
@@ -83,25 +162,59 @@ public:
         data.pop_back();
     }
     
-    // 清空栈
+    // 清空栈，保留已分配的容量以便跨调用复用
     void clear() {
         data.clear();
     }
 };
 
-// 阶乘函数
+// double 能表示的最大阶乘为 170!
+const int MAX_FACTORIAL = 170;
+
+// 编译期生成的阶乘表
+constexpr std::array<double, MAX_FACTORIAL + 1> factorialTable = [] {
+    std::array<double, MAX_FACTORIAL + 1> table{};
+    table[0] = 1;
+    for (int i = 1; i <= MAX_FACTORIAL; i++) {
+        table[i] = table[i - 1] * i;
+    }
+    return table;
+}();
+
+// 阶乘的定义域：非负数（非整数按 Γ(n+1) 计算），NaN 不在其中
+bool factorialDefined(double n) {
+    return n >= 0;
+}
+
+// 阶乘函数：整数查表，非整数走 Γ 函数，均为 O(1)
 double factorial(double n) {
-    if (n < 0 || n != (int)n) {
-        throw std::runtime_error("Factorial only defined for non-negative integers");
+    if (!factorialDefined(n)) {
+        throw std::runtime_error("Factorial only defined for non-negative numbers");
+    }
+    if (n == std::floor(n)) {
+        return n <= MAX_FACTORIAL ? factorialTable[(int)n] : std::numeric_limits<double>::infinity();
     }
-    if (n == 0 || n == 1) {
-        return 1;
+    return std::tgamma(n + 1);
+}
+
+// a!/b!：差值小、且都能精确表示为整数（< 2^53）时直接连乘，都在表内时查表相除，
+// 否则在对数空间计算，中间结果不会溢出
+double factorialRatio(double a, double b) {
+    bool integers = a == std::floor(a) && b == std::floor(b);
+    const double exactLimit = 9007199254740992.0;  // 2^53
+    if (integers && std::abs(a - b) <= 64 && std::max(a, b) < exactLimit) {
+        double low = std::min(a, b);
+        int steps = (int)(std::max(a, b) - low);
+        double product = 1;
+        for (int k = 1; k <= steps; k++) {
+            product *= low + k;
+        }
+        return a >= b ? product : 1 / product;
     }
-    double result = 1;
-    for (int i = 2; i <= (int)n; i++) {
-        result *= i;
+    if (integers && a <= MAX_FACTORIAL && b <= MAX_FACTORIAL) {
+        return factorialTable[(int)a] / factorialTable[(int)b];
     }
-    return result;
+    return std::exp(std::lgamma(a + 1) - std::lgamma(b + 1));
 }
 
 // 执行二元运算
@@ -137,54 +250,51 @@ char getPriority(Operator op1, Operator op2) {
     return pri[op1][op2];
 }
 
-std::pair<double, int> getNextNumber(const std::string& expr, int start) {
-    std::string numStr = "";
+// 负号前一个字符为表达式开头或运算符时，负号属于数字
+bool isSignPosition(std::string_view expr, int i) {
+    return i == 0 || expr[i-1] == '(' || expr[i-1] == '+' || expr[i-1] == '-' ||
+           expr[i-1] == '*' || expr[i-1] == '/' || expr[i-1] == '^';
+}
+
+std::pair<double, int> getNextNumber(std::string_view expr, int start) {
     int i = start;
     
     // 处理负号
-    if (i < expr.length() && expr[i] == '-' && 
-        (i == 1 || expr[i-1] == '(' || expr[i-1] == '+' || expr[i-1] == '-' || 
-         expr[i-1] == '*' || expr[i-1] == '/' || expr[i-1] == '^')) {
-        numStr += expr[i];
+    if (i < (int)expr.length() && expr[i] == '-' && isSignPosition(expr, i)) {
         i++;
     }
     
     // 收集数字字符（包括小数点）
-    while (i < expr.length() && (isDigit(expr[i]) || expr[i] == '.')) {
-        numStr += expr[i];
+    while (i < (int)expr.length() && isDigit(expr[i])) {
         i++;
     }
     
-    if (numStr.empty()) {
-        throw std::runtime_error("Invalid number format");
-    }
-    
-    try {
-        double num = std::stod(numStr);
-        return std::make_pair(num, i);
-    } catch (...) {
+    // 直接在原串上解析，不构造临时字符串
+    double num = 0;
+    auto res = std::from_chars(expr.data() + start, expr.data() + i, num);
+    if (res.ec != std::errc()) {
         throw std::runtime_error("Invalid number format");
     }
+    return std::make_pair(num, i);
 }
 
-double evaluateBasicExpression(const std::string& expression) {
-    if (expression.empty()) {
+double evaluateBasicExpression(std::string_view expr) {
+    if (expr.empty()) {
         return 0;
     }
     
-    std::string expr = '\0' + expression + '\0';
-    
-    Stack<double> operandStack; 
-    Stack<Operator> operatorStack; 
+    // 两个栈按线程复用，稳态下不再分配内存；表达式首尾不再拷贝补 '\0'，
+    // 越界位置视为虚拟的 '\0'
+    static thread_local Stack<double> operandStack;
+    static thread_local Stack<Operator> operatorStack;
+    operandStack.clear();
+    operatorStack.clear();
     operatorStack.push(char2optr('\0')); 
     
-    int i = 1; 
+    int i = 0; 
     
-    while (i < expr.length()) {
-        if (isDigit(expr[i]) || 
-            (expr[i] == '-' && (i == 1 || expr[i-1] == '\0' || expr[i-1] == '(' || 
-                                expr[i-1] == '+' || expr[i-1] == '-' || 
-                                expr[i-1] == '*' || expr[i-1] == '/' || expr[i-1] == '^'))) {
+    while (i < (int)expr.length()) {
+        if (isDigit(expr[i]) || (expr[i] == '-' && isSignPosition(expr, i))) {
        
             auto numInfo = getNextNumber(expr, i);
             operandStack.push(numInfo.first);
@@ -273,191 +383,2173 @@ double evaluateBasicExpression(const std::string& expression) {
     return operandStack.top();
 }
 
-double evaluateExtendedExpression(const std::string& expression);
+struct FunctionEntry {
+    const char* name;
+    OpCode code;
+};
+
+const FunctionEntry functionTable[] = {
+    {"sin", OP_SIN}, {"cos", OP_COS}, {"tan", OP_TAN}, {"log", OP_LOG},
+    {"ln", OP_LN}, {"sqrt", OP_SQRT}, {"abs", OP_ABS}
+};
 
 class FunctionParser {
 public:
+    // 按名称查找函数，未找到时返回 OP_CONST
+    static OpCode lookupFunction(std::string_view func_name) {
+        for (const FunctionEntry& entry : functionTable) {
+            if (func_name == entry.name) {
+                return entry.code;
+            }
+        }
+        return OP_CONST;
+    }
+
+    static double evaluateFunction(OpCode code, double arg) {
+        switch (code) {
+            case OP_SIN: return sin(arg * M_PI / 180);
+            case OP_COS: return cos(arg * M_PI / 180);
+            case OP_TAN: return tan(arg * M_PI / 180);
+            case OP_LOG:
+                if (arg <= 0) throw std::runtime_error("Log of non-positive number");
+                return log10(arg);
+            case OP_LN:
+                if (arg <= 0) throw std::runtime_error("Ln of non-positive number");
+                return log(arg);
+            case OP_SQRT:
+                if (arg < 0) throw std::runtime_error("Square root of negative number");
+                return sqrt(arg);
+            case OP_ABS: return std::abs(arg);
+            default:
+                throw std::runtime_error("Invalid function code");
+        }
+    }
+
     static double evaluateFunction(const std::string& func_name, double arg) {
-        if (func_name == "sin") {
-            return sin(arg * M_PI / 180); 
-        } else if (func_name == "cos") {
-            return cos(arg * M_PI / 180); 
-        } else if (func_name == "tan") {
-            return tan(arg * M_PI / 180); 
-        } else if (func_name == "log") {
-            if (arg <= 0) throw std::runtime_error("Log of non-positive number");
-            return log10(arg);
-        } else if (func_name == "ln") {
-            if (arg <= 0) throw std::runtime_error("Ln of non-positive number");
-            return log(arg);
-        } else if (func_name == "sqrt") {
-            if (arg < 0) throw std::runtime_error("Square root of negative number");
-            return sqrt(arg);
-        } else if (func_name == "abs") {
-            return abs(arg);
-        } else {
+        OpCode code = lookupFunction(func_name);
+        if (code == OP_CONST) {
             throw std::runtime_error("Unknown function: " + func_name);
         }
+        return evaluateFunction(code, arg);
     }
-    
-    static std::string parseAndReplaceFunctions(const std::string& expression) {
-        std::string result = expression;
-        bool changed = true;
-        
-        while (changed) {
-            changed = false;
-            
-            std::vector<std::string> functions = {"sin", "cos", "tan", "log", "ln", "sqrt", "abs"};
-            
-            for (const std::string& func : functions) {
-                size_t pos = 0;
-                while ((pos = result.find(func, pos)) != std::string::npos) {
-
-                    size_t func_end = pos + func.length();
-                    if (func_end < result.length() && result[func_end] == '(') {
-                        size_t start_pos = pos;
-                        size_t paren_count = 0;
-                        size_t i = func_end + 1; 
-                        
-                        while (i < result.length()) {
-                            if (result[i] == '(') {
-                                paren_count++;
-                            } else if (result[i] == ')') {
-                                if (paren_count == 0) {
-                                    std::string arg_str = result.substr(func_end + 1, i - func_end - 1);
-                                    try {
-
-                                        double arg_value = evaluateExtendedExpression(arg_str);
-                                        double func_result = evaluateFunction(func, arg_value);
-                                        
-                                        std::string replacement = std::to_string(func_result);
-                                        result.replace(start_pos, i - start_pos + 1, replacement);
-                                        
-                                        changed = true;
-                                        pos = start_pos + replacement.length();
-                                        break; 
-                                    } catch (const std::exception& e) {
-                                        pos = i + 1;
-                                        break;
-                                    }
-                                } else {
-                                    paren_count--;
-                                }
-                            }
-                            i++;
-                        }
-                        
-                        if (i >= result.length()) {
-                            pos = func_end + 1; 
-                        }
-                    } else {
-                        pos++; 
-                    }
+};
+
+// ================= 批量求值内核 =================
+
+// 每块处理的行数，块内数据常驻 L1/L2
+const int BATCH_BLOCK = 256;
+
+// 批量求值的逐行错误标志，可按位组合
+enum BatchError : uint8_t {
+    BATCH_OK = 0,
+    BATCH_DIV_ZERO = 1,
+    BATCH_DOMAIN = 2,
+    BATCH_FACTORIAL = 4,
+    BATCH_INVALID = 8     // 表达式本身无效（编译失败），对应 EVAL_INVALID_EXPRESSION
+};
+
+// 标量内核：a[k] = a[k] op b[k]
+void batchBinaryScalar(OpCode code, double* a, const double* b, uint8_t* err, int n) {
+    switch (code) {
+        case OP_ADD: for (int k = 0; k < n; k++) a[k] += b[k]; break;
+        case OP_SUB: for (int k = 0; k < n; k++) a[k] -= b[k]; break;
+        case OP_MUL: for (int k = 0; k < n; k++) a[k] *= b[k]; break;
+        case OP_DIV:
+            for (int k = 0; k < n; k++) {
+                if (b[k] == 0) err[k] |= BATCH_DIV_ZERO;
+                a[k] /= b[k];
+            }
+            break;
+        case OP_FACDIV:
+            for (int k = 0; k < n; k++) {
+                if (!factorialDefined(a[k]) || !factorialDefined(b[k])) {
+                    err[k] |= BATCH_FACTORIAL;
+                    a[k] = std::numeric_limits<double>::quiet_NaN();
+                } else {
+                    a[k] = factorialRatio(a[k], b[k]);
+                }
+            }
+            break;
+        default:
+            for (int k = 0; k < n; k++) a[k] = pow(a[k], b[k]);
+            break;
+    }
+}
+
+// 标量内核：a[k] = f(a[k])
+void batchUnaryScalar(OpCode code, double* a, uint8_t* err, int n) {
+    switch (code) {
+        case OP_NEG: for (int k = 0; k < n; k++) a[k] = -a[k]; break;
+        case OP_ABS: for (int k = 0; k < n; k++) a[k] = std::abs(a[k]); break;
+        case OP_SQRT:
+            for (int k = 0; k < n; k++) {
+                if (a[k] < 0) err[k] |= BATCH_DOMAIN;
+                a[k] = sqrt(a[k]);
+            }
+            break;
+        case OP_SIN: for (int k = 0; k < n; k++) a[k] = sin(a[k] * M_PI / 180); break;
+        case OP_COS: for (int k = 0; k < n; k++) a[k] = cos(a[k] * M_PI / 180); break;
+        case OP_TAN: for (int k = 0; k < n; k++) a[k] = tan(a[k] * M_PI / 180); break;
+        case OP_LOG:
+        case OP_LN:
+            for (int k = 0; k < n; k++) {
+                if (a[k] <= 0) err[k] |= BATCH_DOMAIN;
+                a[k] = code == OP_LOG ? log10(a[k]) : log(a[k]);
+            }
+            break;
+        case OP_FAC:
+            for (int k = 0; k < n; k++) {
+                if (!factorialDefined(a[k])) {
+                    err[k] |= BATCH_FACTORIAL;
+                    a[k] = std::numeric_limits<double>::quiet_NaN();
+                } else {
+                    a[k] = factorial(a[k]);
                 }
             }
+            break;
+        default:
+            break;
+    }
+}
+
+#ifdef CALC_AVX2_DISPATCH
+// 把比较结果的掩码位写入逐行错误标志
+__attribute__((target("avx2")))
+inline void batchMarkErrors(__m256d cmp, uint8_t* err, uint8_t flag) {
+    int bits = _mm256_movemask_pd(cmp);
+    while (bits) {
+        int lane = __builtin_ctz(bits);
+        err[lane] |= flag;
+        bits &= bits - 1;
+    }
+}
+
+__attribute__((target("avx2")))
+void batchBinaryAvx2(OpCode code, double* a, const double* b, uint8_t* err, int n) {
+    if (code == OP_POW || code == OP_FACDIV) {
+        batchBinaryScalar(code, a, b, err, n);
+        return;
+    }
+    const __m256d zero = _mm256_setzero_pd();
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d x = _mm256_loadu_pd(a + k);
+        __m256d y = _mm256_loadu_pd(b + k);
+        switch (code) {
+            case OP_ADD: x = _mm256_add_pd(x, y); break;
+            case OP_SUB: x = _mm256_sub_pd(x, y); break;
+            case OP_MUL: x = _mm256_mul_pd(x, y); break;
+            default:
+                batchMarkErrors(_mm256_cmp_pd(y, zero, _CMP_EQ_OQ), err + k, BATCH_DIV_ZERO);
+                x = _mm256_div_pd(x, y);
+                break;
         }
-        
-        return result;
+        _mm256_storeu_pd(a + k, x);
     }
-};
+    batchBinaryScalar(code, a + k, b + k, err + k, n - k);
+}
 
-// 扩展版计算器，支持复杂函数
-double evaluateExtendedExpression(const std::string& expression) {
-    std::string processed_expr = FunctionParser::parseAndReplaceFunctions(expression);
-    
-    return evaluateBasicExpression(processed_expr);
+__attribute__((target("avx2")))
+void batchUnaryAvx2(OpCode code, double* a, uint8_t* err, int n) {
+    if (code != OP_NEG && code != OP_ABS && code != OP_SQRT) {
+        batchUnaryScalar(code, a, err, n);
+        return;
+    }
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d zero = _mm256_setzero_pd();
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d x = _mm256_loadu_pd(a + k);
+        switch (code) {
+            case OP_NEG: x = _mm256_xor_pd(x, signMask); break;
+            case OP_ABS: x = _mm256_andnot_pd(signMask, x); break;
+            default:
+                batchMarkErrors(_mm256_cmp_pd(x, zero, _CMP_LT_OQ), err + k, BATCH_DOMAIN);
+                x = _mm256_sqrt_pd(x);
+                break;
+        }
+        _mm256_storeu_pd(a + k, x);
+    }
+    batchUnaryScalar(code, a + k, err + k, n - k);
 }
 
-void runTests() {
-    std::cout << "=== 字符串计算器测试 ===" << std::endl;
-    
-    std::vector<std::string> testCases = {
-        "2+3",           // 基础加法
-        "2*3+5",         // 混合运算
-        "(2+3)*5",       // 括号运算
-        "2^3",           // 幂运算
-        "5!",            // 阶乘
-        "2+3*4",         // 运算优先级
-        "(2+3)*4-5",     // 复杂表达式
-        "((2+3)*4-5)/2", // 嵌套括号
-        "2+-3",          // 负数
-        "-5+3",          // 表达式以负号开始
+bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+void batchBinary(OpCode code, double* a, const double* b, uint8_t* err, int n) {
+#ifdef CALC_AVX2_DISPATCH
+    if (cpuHasAvx2()) {
+        batchBinaryAvx2(code, a, b, err, n);
+        return;
+    }
+#endif
+    batchBinaryScalar(code, a, b, err, n);
+}
+
+void batchUnary(OpCode code, double* a, uint8_t* err, int n) {
+#ifdef CALC_AVX2_DISPATCH
+    if (cpuHasAvx2()) {
+        batchUnaryAvx2(code, a, err, n);
+        return;
+    }
+#endif
+    batchUnaryScalar(code, a, err, n);
+}
+
+// 求值错误类型，不抛异常的接口用它返回错误
+typedef enum {
+    EVAL_OK,
+    EVAL_INVALID_NUMBER,
+    EVAL_UNEXPECTED_CHAR,
+    EVAL_UNKNOWN_IDENTIFIER,
+    EVAL_UNKNOWN_FUNCTION,
+    EVAL_MISSING_OPERATOR,
+    EVAL_MISMATCHED_PARENS,
+    EVAL_INVALID_EXPRESSION,
+    EVAL_DIVISION_BY_ZERO,
+    EVAL_LOG_NON_POSITIVE,
+    EVAL_LN_NON_POSITIVE,
+    EVAL_SQRT_NEGATIVE,
+    EVAL_FACTORIAL_DOMAIN
+} EvalError;
+
+const char* const evalErrorMessages[] = {
+    "OK",
+    "Invalid number format",
+    "Unexpected character",
+    "Unknown identifier",
+    "Unknown function",
+    "Missing operator before '('",
+    "Mismatched parentheses",
+    "Invalid expression",
+    "Division by zero",
+    "Log of non-positive number",
+    "Ln of non-positive number",
+    "Square root of negative number",
+    "Factorial only defined for non-negative numbers"
+};
+
+// 错误类型及其在表达式中的字符位置
+struct EvalStatus {
+    EvalError error;
+    size_t offset;
+
+    bool ok() const {
+        return error == EVAL_OK;
+    }
+};
+
+// 不抛异常接口的求值结果
+struct EvalResult {
+    double value;
+    EvalError error;
+    size_t offset;
+
+    bool ok() const {
+        return error == EVAL_OK;
+    }
+};
+
+// 编译后的指令：arg 为常量池下标、变量槽位或临时槽位
+struct Instruction {
+    OpCode code;
+    int arg;
+};
+
+// 编译一次、多次求值的表达式：沿用 pri 表的优先级分析，
+// 但在归约时输出后缀指令而不是立即计算
+class CompiledExpression {
+private:
+    friend class JitExpression;
+
+    // 括号记录：左括号前的函数、是否取负以及函数名的位置
+    struct ParenInfo {
+        OpCode func;
+        bool negate;
+        size_t offset;
     };
-    
-    std::cout << "\n基础运算测试：" << std::endl;
-    for (const auto& test : testCases) {
-        try {
-            double result = evaluateBasicExpression(test);
-            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
-        } catch (const std::exception& e) {
-            std::cout << test << " -> 错误: " << e.what() << std::endl;
+
+    // 待归约的运算符及其位置
+    struct PendingOperator {
+        Operator op;
+        size_t offset;
+    };
+
+    std::vector<Instruction> program;
+    std::vector<size_t> sourceOffsets;  // 每条指令对应的源位置，用于报告运行期错误
+    std::vector<double> constants;
+    std::vector<std::string> variables;
+    int depth = 0;
+    int maxDepth = 0;
+    int tempCount = 0;                  // 公共子表达式占用的临时槽位数
+    size_t nopCount = 0;                // 编译中留下的 OP_NOP 条数
+
+    // 编译用的栈作为成员保留，重复 assign 时复用已分配的容量
+    Stack<PendingOperator> operatorStack;
+    Stack<ParenInfo> parenStack;
+    Stack<size_t> operandEnds;  // 操作数栈上每个值最后一条指令的下标
+
+    void emit(OpCode code, size_t offset, int arg = 0) {
+        program.push_back({code, arg});
+        sourceOffsets.push_back(offset);
+        size_t at = program.size() - 1;
+        if (code == OP_CONST || code == OP_VAR || code == OP_LOAD) {
+            depth++;
+            maxDepth = std::max(maxDepth, depth);
+            operandEnds.push(at);
+        } else if (code >= OP_ADD && code <= OP_FACDIV) {
+            depth--;
+            operandEnds.pop();
+            operandEnds.top() = at;
+        } else {
+            operandEnds.top() = at;
         }
     }
-    
-    // 错误情况测试
-    std::cout << "\n错误处理测试：" << std::endl;
-    std::vector<std::string> errorCases = {
-        "2++3",          // 连续运算符
-        "2)",            // 缺少左括号
-        "(2+3",          // 缺少右括号
-        "5!",            // 有效阶乘
-    };
-    
-    for (const auto& test : errorCases) {
-        try {
-            double result = evaluateBasicExpression(test);
-            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
-        } catch (const std::exception& e) {
-            std::cout << test << " -> 错误: " << e.what() << std::endl;
+
+    void emitConstant(double value, size_t offset) {
+        constants.push_back(value);
+        emit(OP_CONST, offset, (int)constants.size() - 1);
+    }
+
+    void emitOperator(const PendingOperator& pending) {
+        static const OpCode codes[] = {OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_FAC};
+        if (pending.op == DIV) {
+            // a!/b! 合并为一条 OP_FACDIV：右边的阶乘被替换，左边的阶乘原地改成 OP_NOP，
+            // 两个 '!' 的位置都保留下来，出错时仍指向出错的那个
+            size_t rightEnd = operandEnds.top();
+            operandEnds.pop();
+            size_t leftEnd = operandEnds.top();
+            operandEnds.push(rightEnd);
+            if (program[leftEnd].code == OP_FAC && program[rightEnd].code == OP_FAC) {
+                size_t leftBang = sourceOffsets[leftEnd];
+                size_t rightBang = sourceOffsets[rightEnd];
+                program[leftEnd].code = OP_NOP;
+                nopCount++;
+                program.pop_back();
+                sourceOffsets.pop_back();
+                emit(OP_FACDIV, rightBang, (int)leftBang);
+                return;
+            }
         }
+        emit(codes[pending.op], pending.offset);
     }
-    
-    std::cout << "\n复杂函数测试：" << std::endl;
-    std::vector<std::string> functionTests = {
-        "sin(30)",      // sin(30°) = 0.5
-        "cos(60)",      // cos(60°) = 0.5
-        "tan(45)",      // tan(45°) = 1
-        "log(100)",     // log(100) = 2
-        "ln(2.718)",    // ln(e) ≈ 1
-        "sqrt(16)",     // sqrt(16) = 4
-        "abs(-5)",      // abs(-5) = 5
-    };
-    
-    for (const auto& test : functionTests) {
-        try {
-            double result = evaluateExtendedExpression(test);
-            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
-        } catch (const std::exception& e) {
-            std::cout << test << " -> 错误: " << e.what() << std::endl;
+
+    // 一遍删除所有 OP_NOP
+    void removeNops() {
+        if (nopCount == 0) {
+            return;
+        }
+        size_t kept = 0;
+        for (size_t ip = 0; ip < program.size(); ip++) {
+            if (program[ip].code != OP_NOP) {
+                program[kept] = program[ip];
+                sourceOffsets[kept] = sourceOffsets[ip];
+                kept++;
+            }
         }
+        program.resize(kept);
+        sourceOffsets.resize(kept);
+        nopCount = 0;
     }
-    
-    std::cout << "\n混合运算测试：" << std::endl;
-    std::vector<std::string> mixedTests = {
-        "2+sin(30)",    // 2 + 0.5 = 2.5
-        "sqrt(16)*2",   // 4 * 2 = 8
-    };
-    
-    for (const auto& test : mixedTests) {
-        try {
-            double result = evaluateExtendedExpression(test);
-            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
-        } catch (const std::exception& e) {
-            std::cout << test << " -> 错误: " << e.what() << std::endl;
+
+    static EvalStatus fail(EvalError error, size_t offset) {
+        return {error, offset};
+    }
+
+    // 单遍从左到右扫描，函数名作为记号直接挂到其左括号上，
+    // 没有中间字符串，代价与输入长度成线性。出错时返回错误而不抛异常
+    EvalStatus compile(std::string_view expr) {
+        program.clear();
+        sourceOffsets.clear();
+        constants.clear();
+        depth = 0;
+        maxDepth = 0;
+        tempCount = 0;
+        nopCount = 0;
+        operatorStack.clear();
+        parenStack.clear();
+        operandEnds.clear();
+        operatorStack.push({EOE, 0});
+
+        size_t i = 0;
+        bool expectOperand = true;
+
+        while (true) {
+            while (i < expr.length() && std::isspace((unsigned char)expr[i])) {
+                i++;
+            }
+            char c = i < expr.length() ? expr[i] : '\0';
+
+            if (expectOperand) {
+                size_t operandStart = i;
+                bool negate = false;
+                if (c == '-') {
+                    negate = true;
+                    i++;
+                    c = i < expr.length() ? expr[i] : '\0';
+                }
+
+                if (isDigit(c)) {
+                    size_t start = i;
+                    while (i < expr.length() && isDigit(expr[i])) {
+                        i++;
+                    }
+                    double value = 0;
+                    auto res = std::from_chars(expr.data() + start, expr.data() + i, value);
+                    if (res.ec != std::errc() || res.ptr != expr.data() + i) {
+                        return fail(EVAL_INVALID_NUMBER, operandStart);
+                    }
+                    emitConstant(negate ? -value : value, operandStart);
+                    expectOperand = false;
+                } else if (std::isalpha((unsigned char)c) || c == '_') {
+                    size_t start = i;
+                    while (i < expr.length() &&
+                           (std::isalnum((unsigned char)expr[i]) || expr[i] == '_')) {
+                        i++;
+                    }
+                    std::string_view name = expr.substr(start, i - start);
+                    if (i >= expr.length() || expr[i] != '(') {
+                        // 变量在编译期解析为槽位，求值时直接按下标读取
+                        int slot = variableIndex(name);
+                        if (slot < 0) {
+                            return fail(EVAL_UNKNOWN_IDENTIFIER, start);
+                        }
+                        emit(OP_VAR, start, slot);
+                        if (negate) emit(OP_NEG, operandStart);
+                        expectOperand = false;
+                        continue;
+                    }
+                    OpCode func = FunctionParser::lookupFunction(name);
+                    if (func == OP_CONST) {
+                        return fail(EVAL_UNKNOWN_FUNCTION, start);
+                    }
+                    parenStack.push({func, negate, start});
+                    operatorStack.push({L_P, i});
+                    i++;
+                } else if (c == '(') {
+                    parenStack.push({OP_CONST, negate, operandStart});
+                    operatorStack.push({L_P, i});
+                    i++;
+                } else {
+                    return fail(EVAL_INVALID_NUMBER, operandStart);
+                }
+                continue;
+            }
+
+            Operator currOp = char2optr(c);
+            if (currOp == EOE && c != '\0') {
+                return fail(EVAL_UNEXPECTED_CHAR, i);
+            }
+            if (currOp == L_P) {
+                return fail(EVAL_MISSING_OPERATOR, i);
+            }
+
+            bool reduced = false;
+            while (!reduced) {
+                switch (getPriority(operatorStack.top().op, currOp)) {
+                    case '<':
+                        operatorStack.push({currOp, i});
+                        expectOperand = (currOp != FAC);
+                        i++;
+                        reduced = true;
+                        break;
+
+                    case '=':
+                        operatorStack.pop();
+                        if (currOp == EOE) {
+                            if (depth != 1) {
+                                return fail(EVAL_INVALID_EXPRESSION, i);
+                            }
+                            removeNops();
+                            return fail(EVAL_OK, i);
+                        }
+                        {
+                            ParenInfo paren = parenStack.top();
+                            parenStack.pop();
+                            if (paren.func != OP_CONST) emit(paren.func, paren.offset);
+                            if (paren.negate) emit(OP_NEG, paren.offset);
+                        }
+                        i++;
+                        reduced = true;
+                        break;
+
+                    case '>':
+                        emitOperator(operatorStack.top());
+                        operatorStack.pop();
+                        break;
+
+                    default:
+                        // 栈顶为 '(' 时遇到结尾说明缺少右括号，否则缺少左括号
+                        return fail(EVAL_MISMATCHED_PARENS,
+                                    operatorStack.top().op == L_P ? operatorStack.top().offset : i);
+                }
+            }
         }
     }
-}
 
-int main() {
-    runTests();
-    
-    std::cout << "\n=== 交互式计算器 ===" << std::endl;
-    std::cout << "输入表达式进行计算（输入'quit'退出）：" << std::endl;
-    
-    std::string input;
-    while (true) {
-        std::cout << "> ";
-        std::getline(std::cin, input);
+    // 把错误状态转换为异常，保持原有接口的异常信息
+    [[noreturn]] static void throwError(EvalStatus status, std::string_view expr) {
+        std::string message = evalErrorMessages[status.error];
+        if (status.error == EVAL_UNEXPECTED_CHAR && status.offset < expr.length()) {
+            message += std::string(": ") + expr[status.offset];
+        } else if ((status.error == EVAL_UNKNOWN_IDENTIFIER || status.error == EVAL_UNKNOWN_FUNCTION) &&
+                   status.offset < expr.length()) {
+            size_t end = status.offset;
+            while (end < expr.length() && (std::isalnum((unsigned char)expr[end]) || expr[end] == '_')) {
+                end++;
+            }
+            message += ": " + std::string(expr.substr(status.offset, end - status.offset));
+        }
+        throw std::runtime_error(message);
+    }
+
+    // 一元指令的计算，出错时返回对应错误；求值与常量折叠共用
+    static EvalError applyUnary(OpCode code, double& x) noexcept {
+        switch (code) {
+            case OP_FAC:
+                if (!factorialDefined(x)) return EVAL_FACTORIAL_DOMAIN;
+                x = factorial(x);
+                break;
+            case OP_NEG: x = -x; break;
+            case OP_SIN: x = sin(x * M_PI / 180); break;
+            case OP_COS: x = cos(x * M_PI / 180); break;
+            case OP_TAN: x = tan(x * M_PI / 180); break;
+            case OP_LOG:
+                if (x <= 0) return EVAL_LOG_NON_POSITIVE;
+                x = log10(x);
+                break;
+            case OP_LN:
+                if (x <= 0) return EVAL_LN_NON_POSITIVE;
+                x = log(x);
+                break;
+            case OP_SQRT:
+                if (x < 0) return EVAL_SQRT_NEGATIVE;
+                x = sqrt(x);
+                break;
+            case OP_ABS: x = std::abs(x); break;
+            default: break;
+        }
+        return EVAL_OK;
+    }
+
+    // 二元指令的计算，用于常量折叠
+    static EvalError applyBinary(OpCode code, double& a, double b) noexcept {
+        switch (code) {
+            case OP_ADD: a += b; break;
+            case OP_SUB: a -= b; break;
+            case OP_MUL: a *= b; break;
+            case OP_DIV:
+                if (b == 0) return EVAL_DIVISION_BY_ZERO;
+                a /= b;
+                break;
+            case OP_POW: a = pow(a, b); break;
+            case OP_FACDIV:
+                if (!factorialDefined(a) || !factorialDefined(b)) return EVAL_FACTORIAL_DOMAIN;
+                a = factorialRatio(a, b);
+                break;
+            default: break;
+        }
+        return EVAL_OK;
+    }
+
+    // 优化用的表达式 DAG 节点，相同子表达式共用一个节点
+    struct ExprNode {
+        OpCode code;
+        int arg;         // 变量槽位
+        double value;    // 常量值
+        int left;        // 子节点下标，-1 表示无
+        int right;
+        size_t offset;
+    };
+
+    struct ExprBuilder {
+        std::vector<ExprNode> nodes;
+        // 常量按位模式比较，NaN 也能作为键
+        std::map<std::tuple<int, int, uint64_t, int, int>, int> index;
+
+        int intern(const ExprNode& node) {
+            auto key = std::make_tuple((int)node.code, node.arg, std::bit_cast<uint64_t>(node.value),
+                                       node.left, node.right);
+            auto it = index.find(key);
+            if (it != index.end()) {
+                return it->second;
+            }
+            nodes.push_back(node);
+            index.emplace(key, (int)nodes.size() - 1);
+            return (int)nodes.size() - 1;
+        }
+
+        int constant(double value, size_t offset) {
+            return intern({OP_CONST, 0, value, -1, -1, offset});
+        }
+
+        bool isConstant(int id, double value) const {
+            return nodes[id].code == OP_CONST && nodes[id].value == value;
+        }
+
+        // 常量折叠与恒等化简；折叠会出错的子树保留到运行期报告
+        int binary(OpCode code, int a, int b, size_t offset, int arg = 0) {
+            if (nodes[a].code == OP_CONST && nodes[b].code == OP_CONST) {
+                double value = nodes[a].value;
+                if (applyBinary(code, value, nodes[b].value) == EVAL_OK) {
+                    return constant(value, offset);
+                }
+            }
+            switch (code) {
+                case OP_ADD:
+                    if (isConstant(b, 0)) return a;
+                    if (isConstant(a, 0)) return b;
+                    break;
+                case OP_SUB:
+                    if (isConstant(b, 0)) return a;
+                    break;
+                case OP_MUL:
+                    if (isConstant(b, 1)) return a;
+                    if (isConstant(a, 1)) return b;
+                    break;
+                case OP_DIV:
+                case OP_POW:
+                    if (isConstant(b, 1)) return a;
+                    break;
+                default:
+                    break;
+            }
+            return intern({code, arg, 0, a, b, offset});
+        }
+
+        int unary(OpCode code, int a, size_t offset) {
+            if (nodes[a].code == OP_CONST) {
+                double value = nodes[a].value;
+                if (applyUnary(code, value) == EVAL_OK) {
+                    return constant(value, offset);
+                }
+            }
+            if (code == OP_NEG && nodes[a].code == OP_NEG) {
+                return nodes[a].left;
+            }
+            if (code == OP_ABS && nodes[a].code == OP_ABS) {
+                return a;
+            }
+            if (code == OP_ABS && nodes[a].code == OP_NEG) {
+                return unary(OP_ABS, nodes[a].left, offset);
+            }
+            return intern({code, 0, 0, a, -1, offset});
+        }
+    };
+
+    // 按后序把 DAG 重新输出为指令，被多处引用的子表达式首次计算后存入临时槽位
+    void emitTree(const ExprBuilder& builder, int root) {
+        const std::vector<ExprNode>& nodes = builder.nodes;
+
+        // 节点按子先父后的顺序创建，倒序一遍即可统计可达节点的引用次数
+        std::vector<int> uses(nodes.size(), 0);
+        uses[root] = 1;
+        for (int id = root; id >= 0; id--) {
+            if (uses[id] == 0) continue;
+            if (nodes[id].left >= 0) uses[nodes[id].left]++;
+            if (nodes[id].right >= 0) uses[nodes[id].right]++;
+        }
+
+        program.clear();
+        sourceOffsets.clear();
+        constants.clear();
+        operandEnds.clear();
+        depth = 0;
+        maxDepth = 0;
+        tempCount = 0;
+
+        std::vector<int> tempSlot(nodes.size(), -1);
+        std::vector<std::pair<int, int>> work = {{root, 0}};
+        while (!work.empty()) {
+            auto& [id, stage] = work.back();
+            const ExprNode& node = nodes[id];
+            if (stage == 0) {
+                if (tempSlot[id] >= 0) {
+                    emit(OP_LOAD, node.offset, tempSlot[id]);
+                    work.pop_back();
+                } else if (node.code == OP_CONST) {
+                    emitConstant(node.value, node.offset);
+                    work.pop_back();
+                } else if (node.code == OP_VAR) {
+                    emit(OP_VAR, node.offset, node.arg);
+                    work.pop_back();
+                } else {
+                    stage = 1;
+                    work.push_back({node.left, 0});
+                }
+            } else if (stage == 1 && node.right >= 0) {
+                stage = 2;
+                work.push_back({node.right, 0});
+            } else {
+                emit(node.code, node.offset, node.arg);
+                if (uses[id] > 1) {
+                    tempSlot[id] = tempCount++;
+                    emit(OP_STORE, node.offset, tempSlot[id]);
+                }
+                work.pop_back();
+            }
+        }
+    }
+
+public:
+    CompiledExpression() {}
+
+    explicit CompiledExpression(const std::string& expression) {
+        assign(expression);
+    }
+
+    // variableNames 的顺序即求值时 values 数组的槽位顺序
+    CompiledExpression(const std::string& expression,
+                       const std::vector<std::string>& variableNames)
+        : variables(variableNames) {
+        assign(expression);
+    }
+
+    // 重新编译为另一个表达式，复用已有的缓冲区
+    void assign(std::string_view expression) {
+        EvalStatus status = compile(expression);
+        if (!status.ok()) {
+            throwError(status, expression);
+        }
+    }
+
+    // 不抛异常的编译，失败时返回错误类型与字符位置
+    EvalStatus tryAssign(std::string_view expression) {
+        EvalStatus status = compile(expression);
+        if (!status.ok()) {
+            program.clear();
+        }
+        return status;
+    }
+
+    // 优化：折叠常量子表达式（含字面量的阶乘），化简 x*1、x+0 等恒等式，
+    // 并把重复出现的子表达式提出来只算一次。不做浮点重结合，结果与未优化时一致
+    void optimize() {
+        if (program.empty()) {
+            return;
+        }
+        ExprBuilder builder;
+        std::vector<int> stack;
+        for (size_t ip = 0; ip < program.size(); ip++) {
+            const Instruction& ins = program[ip];
+            size_t offset = sourceOffsets[ip];
+            switch (ins.code) {
+                case OP_CONST:
+                    stack.push_back(builder.constant(constants[ins.arg], offset));
+                    break;
+                case OP_VAR:
+                    stack.push_back(builder.intern({OP_VAR, ins.arg, 0, -1, -1, offset}));
+                    break;
+                case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW: case OP_FACDIV: {
+                    int b = stack.back();
+                    stack.pop_back();
+                    stack.back() = builder.binary(ins.code, stack.back(), b, offset, ins.arg);
+                    break;
+                }
+                case OP_LOAD: case OP_STORE:
+                    // 已经优化过的程序不再重复处理
+                    return;
+                default:
+                    stack.back() = builder.unary(ins.code, stack.back(), offset);
+                    break;
+            }
+        }
+        emitTree(builder, stack.back());
+    }
+
+    // 指令条数
+    size_t size() const {
+        return program.size();
+    }
+
+    int variableCount() const {
+        return (int)variables.size();
+    }
+
+    // 变量名对应的槽位，不存在时返回 -1
+    int variableIndex(std::string_view name) const {
+        for (size_t k = 0; k < variables.size(); k++) {
+            if (variables[k] == name) {
+                return (int)k;
+            }
+        }
+        return -1;
+    }
+
+    // 只用于没有变量的表达式，否则 OP_VAR 会读取空指针
+    double eval() const {
+        if (!variables.empty()) {
+            throw std::runtime_error("Expression has variables; values are required");
+        }
+        return eval(nullptr);
+    }
+
+    // values[k] 为第 k 个变量的取值
+    double eval(const double* values) const {
+        double result = 0;
+        EvalStatus status = tryEval(values, result);
+        if (!status.ok()) {
+            throw std::runtime_error(evalErrorMessages[status.error]);
+        }
+        return result;
+    }
+
+    // 不抛异常的求值：运行期错误只是提前返回，代价与正常路径相同
+    EvalStatus tryEval(const double* values, double& result) const noexcept {
+        if (program.empty()) {
+            result = 0;
+            return fail(EVAL_INVALID_EXPRESSION, 0);
+        }
+
+        // 操作数栈之后紧跟临时槽位
+        double localStack[32];
+        double* stack = localStack;
+        const int scratch = maxDepth + tempCount;
+        if (scratch > 32) {
+            static thread_local std::vector<double> heapStack;
+            if ((int)heapStack.size() < scratch) {
+                heapStack.resize(scratch);
+            }
+            stack = heapStack.data();
+        }
+        double* temps = stack + maxDepth;
+
+        double* top = stack - 1;
+        const size_t count = program.size();
+        for (size_t ip = 0; ip < count; ip++) {
+            const Instruction& ins = program[ip];
+            switch (ins.code) {
+                case OP_CONST: *++top = constants[ins.arg]; break;
+                case OP_ADD: top[-1] += top[0]; --top; break;
+                case OP_SUB: top[-1] -= top[0]; --top; break;
+                case OP_MUL: top[-1] *= top[0]; --top; break;
+                case OP_DIV:
+                    if (top[0] == 0) {
+                        return fail(EVAL_DIVISION_BY_ZERO, sourceOffsets[ip]);
+                    }
+                    top[-1] /= top[0];
+                    --top;
+                    break;
+                case OP_POW: top[-1] = pow(top[-1], top[0]); --top; break;
+                case OP_FACDIV:
+                    // 与合并前的求值顺序一致：先检查左边的阶乘
+                    if (!factorialDefined(top[-1])) {
+                        return fail(EVAL_FACTORIAL_DOMAIN, (size_t)ins.arg);
+                    }
+                    if (!factorialDefined(top[0])) {
+                        return fail(EVAL_FACTORIAL_DOMAIN, sourceOffsets[ip]);
+                    }
+                    top[-1] = factorialRatio(top[-1], top[0]);
+                    --top;
+                    break;
+                case OP_NEG: *top = -*top; break;
+                case OP_VAR: *++top = values[ins.arg]; break;
+                case OP_LOAD: *++top = temps[ins.arg]; break;
+                case OP_STORE: temps[ins.arg] = *top; break;
+                default: {
+                    EvalError error = applyUnary(ins.code, *top);
+                    if (error != EVAL_OK) {
+                        return fail(error, sourceOffsets[ip]);
+                    }
+                    break;
+                }
+            }
+        }
+        result = *top;
+        return fail(EVAL_OK, 0);
+    }
+
+    // 列式批量求值：columns[k] 为第 k 个变量的输入列，结果写入 out。
+    // 出错的行不抛异常，errors 中记录 BatchError 标志，out 中为 NaN。
+    // 返回出错的行数。
+    size_t evalBatch(std::span<const std::span<const double>> columns,
+                     std::span<double> out, std::span<uint8_t> errors) const {
+        const size_t rows = out.size();
+        if (columns.size() < variables.size() || errors.size() < rows) {
+            throw std::runtime_error("Batch size mismatch");
+        }
+        for (size_t k = 0; k < variables.size(); k++) {
+            if (columns[k].size() < rows) {
+                throw std::runtime_error("Batch size mismatch");
+            }
+        }
+
+        // 编译失败后程序为空，与 tryEval 一样每一行都报告无效表达式
+        if (program.empty()) {
+            std::fill(out.begin(), out.end(), std::numeric_limits<double>::quiet_NaN());
+            std::fill(errors.begin(), errors.begin() + rows, (uint8_t)BATCH_INVALID);
+            return rows;
+        }
+
+        // 操作数栈的每一层是一整块，之后是临时槽位的块
+        std::vector<double> blocks((size_t)std::max(maxDepth + tempCount, 1) * BATCH_BLOCK);
+        double* temps = blocks.data() + (size_t)maxDepth * BATCH_BLOCK;
+        size_t failed = 0;
+
+        for (size_t base = 0; base < rows; base += BATCH_BLOCK) {
+            const int n = (int)std::min<size_t>(BATCH_BLOCK, rows - base);
+            uint8_t* err = errors.data() + base;
+            std::fill(err, err + n, (uint8_t)BATCH_OK);
+
+            double* top = blocks.data() - BATCH_BLOCK;
+            for (const Instruction& ins : program) {
+                switch (ins.code) {
+                    case OP_CONST:
+                        top += BATCH_BLOCK;
+                        std::fill(top, top + n, constants[ins.arg]);
+                        break;
+                    case OP_VAR:
+                        top += BATCH_BLOCK;
+                        std::copy(columns[ins.arg].data() + base,
+                                  columns[ins.arg].data() + base + n, top);
+                        break;
+                    case OP_LOAD:
+                        top += BATCH_BLOCK;
+                        std::copy(temps + ins.arg * BATCH_BLOCK, temps + ins.arg * BATCH_BLOCK + n, top);
+                        break;
+                    case OP_STORE:
+                        std::copy(top, top + n, temps + ins.arg * BATCH_BLOCK);
+                        break;
+                    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW: case OP_FACDIV:
+                        batchBinary(ins.code, top - BATCH_BLOCK, top, err, n);
+                        top -= BATCH_BLOCK;
+                        break;
+                    default:
+                        batchUnary(ins.code, top, err, n);
+                        break;
+                }
+            }
+
+            for (int k = 0; k < n; k++) {
+                if (err[k] != BATCH_OK) {
+                    out[base + k] = std::numeric_limits<double>::quiet_NaN();
+                    failed++;
+                } else {
+                    out[base + k] = top[k];
+                }
+            }
+        }
+        return failed;
+    }
+};
+
+// 扩展版计算器，支持复杂函数
+double evaluateExtendedExpression(const std::string& expression) {
+    if (expression.empty()) {
+        return 0;
+    }
+    // 每个线程复用同一个编译缓冲区，稳态下不再分配内存
+    static thread_local CompiledExpression compiled;
+    compiled.assign(expression);
+    return compiled.eval();
+}
+
+// 不抛异常的扩展计算器：返回结果或错误类型加字符位置，
+// 非法输入与合法输入走同一条路径，没有栈展开的开销
+EvalResult tryEvaluateExtendedExpression(std::string_view expression) {
+    if (expression.empty()) {
+        return {0, EVAL_OK, 0};
+    }
+    static thread_local CompiledExpression compiled;
+    EvalStatus status = compiled.tryAssign(expression);
+    double value = 0;
+    if (status.ok()) {
+        status = compiled.tryEval(nullptr, value);
+    }
+    return {value, status.error, status.offset};
+}
+
+// ================= 本地代码生成（x86-64 JIT） =================
+
+#ifdef CALC_JIT_X64
+// 生成代码调用的辅助函数，统一为 double(double) 以便按地址调用
+double jitSin(double x) { return sin(x * M_PI / 180); }
+double jitCos(double x) { return cos(x * M_PI / 180); }
+double jitTan(double x) { return tan(x * M_PI / 180); }
+double jitLog10(double x) { return log10(x); }
+double jitLn(double x) { return log(x); }
+double jitPow(double a, double b) { return pow(a, b); }
+
+// 阶乘定义域错误时返回 NaN，由生成代码检查后转入出错出口
+double jitFactorial(double x) {
+    if (!factorialDefined(x)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return factorial(x);
+}
+
+double jitFactorialRatio(double a, double b) {
+    if (!factorialDefined(a) || !factorialDefined(b)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return factorialRatio(a, b);
+}
+
+// 可执行内存：先以可写方式填入机器码，再切换为只读可执行
+void* allocateExecutable(const std::vector<uint8_t>& code) {
+#ifdef _WIN32
+    void* memory = VirtualAlloc(nullptr, code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!memory) {
+        return nullptr;
+    }
+    std::copy(code.begin(), code.end(), (uint8_t*)memory);
+    DWORD oldProtect;
+    if (!VirtualProtect(memory, code.size(), PAGE_EXECUTE_READ, &oldProtect)) {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        return nullptr;
+    }
+    FlushInstructionCache(GetCurrentProcess(), memory, code.size());
+    return memory;
+#else
+    void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::copy(code.begin(), code.end(), (uint8_t*)memory);
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, code.size());
+        return nullptr;
+    }
+    return memory;
+#endif
+}
+
+void releaseExecutable(void* memory, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
+
+// 最小的 x86-64 指令编码器，只覆盖表达式需要的 SSE2 标量指令
+class X64Emitter {
+private:
+    std::vector<uint8_t> code;
+    std::vector<size_t> errorJumps;  // 跳往出错出口的 rel32 位置
+
+    void byte(uint8_t b) { code.push_back(b); }
+
+    void bytes(std::initializer_list<uint8_t> list) {
+        code.insert(code.end(), list);
+    }
+
+    void imm32(int32_t value) {
+        for (int k = 0; k < 4; k++) byte((uint8_t)(value >> (8 * k)));
+    }
+
+    void imm64(uint64_t value) {
+        for (int k = 0; k < 8; k++) byte((uint8_t)(value >> (8 * k)));
+    }
+
+public:
+    const std::vector<uint8_t>& bytesOut() const { return code; }
+
+    // push rbx; mov rbx, <第一个参数>; sub rsp, frame
+    void prologue(int32_t frame) {
+        byte(0x53);
+#ifdef _WIN32
+        bytes({0x48, 0x89, 0xCB});
+#else
+        bytes({0x48, 0x89, 0xFB});
+#endif
+        bytes({0x48, 0x81, 0xEC});
+        imm32(frame);
+    }
+
+    // add rsp, frame; pop rbx; ret
+    void epilogue(int32_t frame) {
+        bytes({0x48, 0x81, 0xC4});
+        imm32(frame);
+        byte(0x5B);
+        byte(0xC3);
+    }
+
+    // movsd xmmN, [rsp + disp]
+    void loadStack(int xmm, int32_t disp) {
+        bytes({0xF2, 0x0F, 0x10, (uint8_t)(0x84 | (xmm << 3)), 0x24});
+        imm32(disp);
+    }
+
+    // movsd [rsp + disp], xmmN
+    void storeStack(int xmm, int32_t disp) {
+        bytes({0xF2, 0x0F, 0x11, (uint8_t)(0x84 | (xmm << 3)), 0x24});
+        imm32(disp);
+    }
+
+    // movsd xmm0, [rbx + disp]
+    void loadArgument(int32_t disp) {
+        bytes({0xF2, 0x0F, 0x10, 0x83});
+        imm32(disp);
+    }
+
+    // mov rax, imm64; mov [rsp + disp], rax
+    void storeConstant(double value, int32_t disp) {
+        bytes({0x48, 0xB8});
+        imm64(std::bit_cast<uint64_t>(value));
+        bytes({0x48, 0x89, 0x84, 0x24});
+        imm32(disp);
+    }
+
+    // mov rax, imm64; movq xmmN, rax
+    void loadBits(int xmm, uint64_t bits) {
+        bytes({0x48, 0xB8});
+        imm64(bits);
+        bytes({0x66, 0x48, 0x0F, 0x6E, (uint8_t)(0xC0 | (xmm << 3))});
+    }
+
+    // addsd/subsd/mulsd/divsd xmm0, xmm1
+    void arithmetic(uint8_t opcode) {
+        bytes({0xF2, 0x0F, opcode, 0xC1});
+    }
+
+    void sqrt0() { bytes({0xF2, 0x0F, 0x51, 0xC0}); }
+    void andpd01() { bytes({0x66, 0x0F, 0x54, 0xC1}); }
+    void xorpd01() { bytes({0x66, 0x0F, 0x57, 0xC1}); }
+    void zero2() { bytes({0x66, 0x0F, 0x57, 0xD2}); }
+
+    // ucomisd xmmA, xmmB
+    void compare(int a, int b) {
+        bytes({0x66, 0x0F, 0x2E, (uint8_t)(0xC0 | (a << 3) | b)});
+    }
+
+    // mov rax, imm64; call rax
+    void call(const void* target) {
+        bytes({0x48, 0xB8});
+        imm64((uint64_t)(uintptr_t)target);
+        bytes({0xFF, 0xD0});
+    }
+
+    // 条件跳转到出错出口，位置在 bindErrorExit 时回填
+    void jumpToError(uint8_t condition) {
+        bytes({0x0F, condition});
+        errorJumps.push_back(code.size());
+        imm32(0);
+    }
+
+    void bindErrorExit() {
+        for (size_t at : errorJumps) {
+            int32_t rel = (int32_t)(code.size() - (at + 4));
+            for (int k = 0; k < 4; k++) code[at + k] = (uint8_t)(rel >> (8 * k));
+        }
+    }
+};
+#endif
+
+// 可选的本地代码后端：把编译后的表达式翻译成 x86-64 机器码。
+// 不支持的平台或无法申请可执行内存时自动退回解释执行。
+// 生成代码遇到任何运行期错误都返回 NaN，再交给解释器给出确切的错误与位置
+class JitExpression {
+private:
+    typedef double (*NativeFunction)(const double* values);
+
+    CompiledExpression interpreter;
+    NativeFunction native = nullptr;
+    void* memory = nullptr;
+    size_t memorySize = 0;
+
+#ifdef CALC_JIT_X64
+    void generate() {
+        const CompiledExpression& expr = interpreter;
+        if (expr.program.empty()) {
+            return;
+        }
+
+        // 栈帧：32 字节影子空间（Win64 调用约定）+ 操作数槽位 + 临时槽位，按 16 字节对齐。
+        // 序言只有一条 sub rsp，不做逐页探测；栈帧超过一页时可能越过 Windows 的保护页，
+        // 嵌套极深时还会撑爆线程栈，这类表达式留给解释器（它的大栈放在堆上）
+        const int64_t MAX_FRAME = 4096 - 64;
+        const int64_t needed = 32 + 8 * ((int64_t)expr.maxDepth + expr.tempCount);
+        if (needed > MAX_FRAME) {
+            return;
+        }
+        const int32_t base = 32;
+        const int32_t tempBase = base + 8 * expr.maxDepth;
+        const int32_t frame = (tempBase + 8 * expr.tempCount + 15) & ~15;
+        auto slot = [&](int k) { return base + 8 * k; };
+
+        X64Emitter out;
+        out.prologue(frame);
+        int d = 0;
+        for (const Instruction& ins : expr.program) {
+            switch (ins.code) {
+                case OP_CONST:
+                    out.storeConstant(expr.constants[ins.arg], slot(d++));
+                    break;
+                case OP_VAR:
+                    out.loadArgument(8 * ins.arg);
+                    out.storeStack(0, slot(d++));
+                    break;
+                case OP_LOAD:
+                    out.loadStack(0, tempBase + 8 * ins.arg);
+                    out.storeStack(0, slot(d++));
+                    break;
+                case OP_STORE:
+                    out.loadStack(0, slot(d - 1));
+                    out.storeStack(0, tempBase + 8 * ins.arg);
+                    break;
+                case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW: case OP_FACDIV:
+                    out.loadStack(0, slot(d - 2));
+                    out.loadStack(1, slot(d - 1));
+                    switch (ins.code) {
+                        case OP_ADD: out.arithmetic(0x58); break;
+                        case OP_SUB: out.arithmetic(0x5C); break;
+                        case OP_MUL: out.arithmetic(0x59); break;
+                        case OP_DIV:
+                            out.zero2();
+                            out.compare(1, 2);
+                            out.jumpToError(0x84);  // je：除数为 0（或 NaN）
+                            out.arithmetic(0x5E);
+                            break;
+                        case OP_FACDIV:
+                            out.call((const void*)&jitFactorialRatio);
+                            out.compare(0, 0);
+                            out.jumpToError(0x8A);  // jp：定义域错误
+                            break;
+                        default:
+                            out.call((const void*)&jitPow);
+                            break;
+                    }
+                    out.storeStack(0, slot(d - 2));
+                    d--;
+                    break;
+                default:
+                    out.loadStack(0, slot(d - 1));
+                    switch (ins.code) {
+                        case OP_NEG:
+                            out.loadBits(1, 0x8000000000000000ull);
+                            out.xorpd01();
+                            break;
+                        case OP_ABS:
+                            out.loadBits(1, 0x7FFFFFFFFFFFFFFFull);
+                            out.andpd01();
+                            break;
+                        case OP_SQRT:
+                            out.zero2();
+                            out.compare(0, 2);
+                            out.jumpToError(0x82);  // jb：负数
+                            out.sqrt0();
+                            break;
+                        case OP_LOG:
+                        case OP_LN:
+                            out.zero2();
+                            out.compare(0, 2);
+                            out.jumpToError(0x86);  // jbe：非正数
+                            out.call(ins.code == OP_LOG ? (const void*)&jitLog10 : (const void*)&jitLn);
+                            break;
+                        case OP_SIN: out.call((const void*)&jitSin); break;
+                        case OP_COS: out.call((const void*)&jitCos); break;
+                        case OP_TAN: out.call((const void*)&jitTan); break;
+                        case OP_FAC:
+                            out.call((const void*)&jitFactorial);
+                            out.compare(0, 0);
+                            out.jumpToError(0x8A);  // jp：结果为 NaN
+                            break;
+                        default:
+                            return;
+                    }
+                    out.storeStack(0, slot(d - 1));
+                    break;
+            }
+        }
+        out.loadStack(0, slot(0));
+        out.epilogue(frame);
+
+        // 出错出口：返回 NaN
+        out.bindErrorExit();
+        out.loadBits(0, std::bit_cast<uint64_t>(std::numeric_limits<double>::quiet_NaN()));
+        out.epilogue(frame);
+
+        memory = allocateExecutable(out.bytesOut());
+        if (memory) {
+            memorySize = out.bytesOut().size();
+            native = (NativeFunction)memory;
+        }
+    }
+#endif
+
+public:
+    explicit JitExpression(const CompiledExpression& expression) : interpreter(expression) {
+#ifdef CALC_JIT_X64
+        generate();
+#endif
+    }
+
+    JitExpression(const JitExpression&) = delete;
+    JitExpression& operator=(const JitExpression&) = delete;
+
+    ~JitExpression() {
+#ifdef CALC_JIT_X64
+        if (memory) {
+            releaseExecutable(memory, memorySize);
+        }
+#endif
+    }
+
+    // 是否生成了本地代码
+    bool isNative() const {
+        return native != nullptr;
+    }
+
+    double eval(const double* values) const {
+        if (native) {
+            double result = native(values);
+            if (result == result) {
+                return result;
+            }
+        }
+        return interpreter.eval(values);
+    }
+
+    EvalStatus tryEval(const double* values, double& result) const noexcept {
+        if (native) {
+            result = native(values);
+            if (result == result) {
+                return {EVAL_OK, 0};
+            }
+        }
+        return interpreter.tryEval(values, result);
+    }
+};
+
+// ================= 批量求值服务 =================
+
+// 工作窃取线程池：每个工作线程有自己的双端队列，从队尾取任务，
+// 自己的队列空了就从其他线程的队首窃取
+class WorkStealingPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued{0};    // 已入队未取出的任务数
+    std::atomic<size_t> pending{0};   // 已提交未完成的任务数
+    std::atomic<size_t> nextQueue{0};
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping = false;
+
+    bool takeTask(size_t self, std::function<void()>& task) {
+        {
+            WorkQueue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            WorkQueue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        std::function<void()> task;
+        while (true) {
+            if (takeTask(self, task)) {
+                queued--;
+                task();
+                if (--pending == 0) {
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    idle.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [&] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned threadCount) {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned k = 0; k < threadCount; k++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (unsigned k = 0; k < threadCount; k++) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, k);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+
+    size_t threadCount() const {
+        return threads.size();
+    }
+
+    void submit(std::function<void()> task) {
+        pending++;
+        WorkQueue& target = *queues[nextQueue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(target.mutex);
+            target.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // 等待所有已提交的任务完成
+    void wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        idle.wait(lock, [&] { return pending == 0; });
+    }
+};
+
+// 按表达式文本缓存编译结果的有界 LRU 缓存。
+// 分成若干分片，各自加锁，减少多线程争用
+class ExpressionCache {
+private:
+    typedef std::shared_ptr<const CompiledExpression> Entry;
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<std::pair<std::string, Entry>> order;  // 队首为最近使用
+        std::unordered_map<std::string_view, std::list<std::pair<std::string, Entry>>::iterator> index;
+    };
+
+    static const size_t SHARDS = 16;
+    Shard shards[SHARDS];
+    size_t shardCapacity;
+    std::atomic<size_t> hitCount{0};
+    std::atomic<size_t> missCount{0};
+
+    Shard& shardFor(std::string_view key) {
+        return shards[std::hash<std::string_view>()(key) % SHARDS];
+    }
+
+public:
+    explicit ExpressionCache(size_t capacity) : shardCapacity(std::max<size_t>(1, capacity / SHARDS)) {}
+
+    Entry find(std::string_view key) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            missCount++;
+            return nullptr;
+        }
+        hitCount++;
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        return it->second->second;
+    }
+
+    void insert(std::string_view key, Entry value) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.index.count(key)) {
+            return;
+        }
+        shard.order.emplace_front(std::string(key), std::move(value));
+        shard.index.emplace(shard.order.front().first, shard.order.begin());
+        if (shard.order.size() > shardCapacity) {
+            shard.index.erase(shard.order.back().first);
+            shard.order.pop_back();
+        }
+    }
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+};
+
+// 按缓存求值一行表达式，结果按交互模式的格式追加到 out
+void evaluateBulkLine(std::string_view line, ExpressionCache& cache, FastWriter& out) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    EvalResult result = {0, EVAL_OK, 0};
+    if (!line.empty()) {
+        std::shared_ptr<const CompiledExpression> compiled = cache.find(line);
+        if (!compiled) {
+            auto fresh = std::make_shared<CompiledExpression>();
+            EvalStatus status = fresh->tryAssign(line);
+            if (status.ok()) {
+                fresh->optimize();
+                cache.insert(line, fresh);
+                compiled = fresh;
+            } else {
+                result = {0, status.error, status.offset};
+            }
+        }
+        if (compiled) {
+            EvalStatus status = compiled->tryEval(nullptr, result.value);
+            result.error = status.error;
+            result.offset = status.offset;
+        }
+    }
+
+    if (result.ok()) {
+        out.put("= ").putFixed(result.value, 6);
+    } else {
+        out.put("错误: ").put(evalErrorMessages[result.error]);
+        out.put(" (位置 ").putInteger((long long)result.offset).put(')');
+    }
+    out.put('\n');
+}
+
+// 批量模式：主线程按大块读入原始字节，在最后一个换行处切开后整块提交给线程池，
+// 分行与求值都在工作线程上进行，读入与求值相互重叠。
+// 各块的结果写入自己的缓冲区，按块的顺序输出；在途的块数有上限，内存占用有界
+void runBulk(std::istream& input) {
+    const size_t chunkBytes = 64 * 1024;
+
+    WorkStealingPool pool(std::thread::hardware_concurrency());
+    ExpressionCache cache(4096);
+    const size_t maxInFlight = pool.threadCount() * 4;
+
+    struct Chunk {
+        std::string text;
+        FastWriter out{nullptr, chunkBytes * 2};
+        size_t lines = 0;
+        bool done = false;  // 由 doneMutex 保护
+    };
+    std::deque<std::unique_ptr<Chunk>> inFlight;
+    std::vector<std::unique_ptr<Chunk>> spare;  // 写出后回收，重复使用缓冲区
+    std::mutex doneMutex;
+    std::condition_variable doneSignal;
+
+    FastWriter writer(&std::cout);
+    size_t total = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // 写出最前面的块；wait 为假且它尚未完成时返回 false
+    auto writeFront = [&](bool wait) {
+        Chunk& front = *inFlight.front();
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            if (wait) {
+                doneSignal.wait(lock, [&] { return front.done; });
+            } else if (!front.done) {
+                return false;
+            }
+        }
+        writer.put(front.out.view());
+        total += front.lines;
+        spare.push_back(std::move(inFlight.front()));
+        inFlight.pop_front();
+        return true;
+    };
+
+    std::string carry;  // 上一块末尾不完整的行
+    bool more = true;
+    while (more) {
+        std::unique_ptr<Chunk> chunk;
+        if (spare.empty()) {
+            chunk = std::make_unique<Chunk>();
+        } else {
+            chunk = std::move(spare.back());
+            spare.pop_back();
+        }
+        std::string& text = chunk->text;
+        text.swap(carry);
+        carry.clear();
+
+        // 读满一块；块内没有换行（超长的行）时继续读，直到遇到换行或输入结束
+        size_t cut = std::string::npos;
+        while (more && cut == std::string::npos) {
+            size_t old = text.size();
+            text.resize(old + chunkBytes);
+            input.read(text.data() + old, chunkBytes);
+            size_t got = (size_t)input.gcount();
+            text.resize(old + got);
+            more = got == chunkBytes;
+            cut = text.rfind('\n');
+        }
+        if (more) {
+            carry.assign(text, cut + 1, std::string::npos);
+            text.resize(cut + 1);
+        }
+        if (text.empty()) {
+            break;
+        }
+
+        chunk->done = false;
+        Chunk* task = chunk.get();
+        pool.submit([&, task] {
+            // 与 std::getline 的分行一致：末尾的换行不产生额外的空行
+            std::string_view rest = task->text;
+            size_t lines = 0;
+            task->out.clear();
+            while (!rest.empty()) {
+                size_t end = rest.find('\n');
+                evaluateBulkLine(rest.substr(0, end), cache, task->out);
+                lines++;
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                rest.remove_prefix(end + 1);
+            }
+            task->lines = lines;
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                task->done = true;
+            }
+            doneSignal.notify_all();
+        });
+        inFlight.push_back(std::move(chunk));
+
+        // 顺带写出已经完成的块；在途块数到达上限时等待最前面的块
+        while (!inFlight.empty() && writeFront(inFlight.size() >= maxInFlight)) {
+        }
+    }
+    while (!inFlight.empty()) {
+        writeFront(true);
+    }
+    writer.flush();
+    std::cout.flush();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cerr << "批量求值: " << total << " 行, " << pool.threadCount() << " 线程, "
+              << std::fixed << std::setprecision(3) << seconds << " 秒, 缓存命中 "
+              << cache.hits() << " / 未命中 " << cache.misses() << std::endl;
+}
+
+void runTests() {
+    std::cout << "=== 字符串计算器测试 ===" << std::endl;
+    
+    std::vector<std::string> testCases = {
+        "2+3",           // 基础加法
+        "2*3+5",         // 混合运算
+        "(2+3)*5",       // 括号运算
+        "2^3",           // 幂运算
+        "5!",            // 阶乘
+        "2+3*4",         // 运算优先级
+        "(2+3)*4-5",     // 复杂表达式
+        "((2+3)*4-5)/2", // 嵌套括号
+        "2+-3",          // 负数
+        "-5+3",          // 表达式以负号开始
+    };
+    
+    std::cout << "\n基础运算测试：" << std::endl;
+    for (const auto& test : testCases) {
+        try {
+            double result = evaluateBasicExpression(test);
+            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << test << " -> 错误: " << e.what() << std::endl;
+        }
+    }
+    
+    // 错误情况测试
+    std::cout << "\n错误处理测试：" << std::endl;
+    std::vector<std::string> errorCases = {
+        "2++3",          // 连续运算符
+        "2)",            // 缺少左括号
+        "(2+3",          // 缺少右括号
+        "5!",            // 有效阶乘
+    };
+    
+    for (const auto& test : errorCases) {
+        try {
+            double result = evaluateBasicExpression(test);
+            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << test << " -> 错误: " << e.what() << std::endl;
+        }
+    }
+    
+    std::cout << "\n复杂函数测试：" << std::endl;
+    std::vector<std::string> functionTests = {
+        "sin(30)",      // sin(30°) = 0.5
+        "cos(60)",      // cos(60°) = 0.5
+        "tan(45)",      // tan(45°) = 1
+        "log(100)",     // log(100) = 2
+        "ln(2.718)",    // ln(e) ≈ 1
+        "sqrt(16)",     // sqrt(16) = 4
+        "abs(-5)",      // abs(-5) = 5
+    };
+    
+    for (const auto& test : functionTests) {
+        try {
+            double result = evaluateExtendedExpression(test);
+            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << test << " -> 错误: " << e.what() << std::endl;
+        }
+    }
+    
+    std::cout << "\n混合运算测试：" << std::endl;
+    std::vector<std::string> mixedTests = {
+        "2+sin(30)",    // 2 + 0.5 = 2.5
+        "sqrt(16)*2",   // 4 * 2 = 8
+    };
+    
+    for (const auto& test : mixedTests) {
+        try {
+            double result = evaluateExtendedExpression(test);
+            std::cout << test << " = " << std::fixed << std::setprecision(6) << result << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << test << " -> 错误: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << "\n编译表达式测试：" << std::endl;
+    std::vector<std::string> compiledTests = {
+        "2+3*4",
+        "((2+3)*4-5)/2",
+        "2^3!",
+        "-sin(30)^2",
+        "sqrt(16)*2+abs(-5)",
+        "2 * (3 + 4)",
+        "1/0",
+        "2(3)",
+    };
+
+    for (const auto& test : compiledTests) {
+        try {
+            CompiledExpression compiled(test);
+            double result = compiled.eval();
+            std::cout << test << " = " << std::fixed << std::setprecision(6) << result
+                      << " (" << compiled.size() << " 条指令)" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << test << " -> 错误: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << "\n变量绑定测试：" << std::endl;
+    CompiledExpression interest("principal*(1+rate/100)^years-principal",
+                                {"principal", "rate", "years"});
+    double inputs[][3] = {{1000, 5, 1}, {1000, 5, 10}, {2500, 3.5, 20}};
+    for (const auto& row : inputs) {
+        std::cout << "principal=" << row[0] << ", rate=" << row[1] << ", years=" << row[2]
+                  << " -> " << interest.eval(row) << std::endl;
+    }
+    try {
+        interest.eval();
+    } catch (const std::exception& e) {
+        std::cout << "含变量的表达式不传取值 -> 错误: " << e.what() << std::endl;
+    }
+
+    CompiledExpression poly("-x^2+2*x*y-y", {"x", "y"});
+    double point[] = {3, 0.5};
+    std::cout << "-x^2+2*x*y-y (x=3, y=0.5) = " << poly.eval(point) << std::endl;
+
+    try {
+        CompiledExpression unknown("x+z", {"x"});
+    } catch (const std::exception& e) {
+        std::cout << "x+z -> 错误: " << e.what() << std::endl;
+    }
+
+    std::cout << "\n表达式优化测试：" << std::endl;
+    std::vector<std::string> optimizeTests = {
+        "sqrt(16)*2+x",
+        "sin(30)*x+2^10",
+        "x*1+0-y/1",
+        "(x+y)*(x+y)+sin(x+y)",
+        "5!*x+(y-1)^2/(y-1)^2",
+        "x/(2-2)",
+    };
+    double xy[] = {1.25, -3};
+    for (const auto& test : optimizeTests) {
+        CompiledExpression plain(test, {"x", "y"});
+        CompiledExpression optimized = plain;
+        optimized.optimize();
+        double before = 0, after = 0;
+        EvalStatus s1 = plain.tryEval(xy, before);
+        EvalStatus s2 = optimized.tryEval(xy, after);
+        std::cout << test << ": " << plain.size() << " -> " << optimized.size() << " 条指令, ";
+        if (s1.ok() && s2.ok()) {
+            std::cout << before << " / " << after << std::endl;
+        } else {
+            std::cout << evalErrorMessages[s1.error] << " / " << evalErrorMessages[s2.error] << std::endl;
+        }
+    }
+
+    std::cout << "\n本地代码测试：" << std::endl;
+    std::vector<std::string> jitTests = {
+        "x*x+2*x*y-y/3",
+        "sqrt(abs(x-y))+ln(x)*log(100)-sin(30)*cos(60)/tan(45)",
+        "(x+y)^2+(x+y)!*0+3!",
+        "1/(1/(y+3))",
+        "sqrt(y)",
+        "(x-1.25)!",
+        "(x+170.75)!/(x+166.75)!",
+        "(y)!",
+    };
+    for (const auto& test : jitTests) {
+        CompiledExpression compiled(test, {"x", "y"});
+        compiled.optimize();
+        JitExpression jit(compiled);
+        double jitValue = 0, interpValue = 0;
+        EvalStatus s1 = jit.tryEval(xy, jitValue);
+        EvalStatus s2 = compiled.tryEval(xy, interpValue);
+        std::cout << test << (jit.isNative() ? " [本地代码] " : " [解释执行] ");
+        if (s1.ok() && s2.ok()) {
+            std::cout << jitValue << " / " << interpValue << std::endl;
+        } else {
+            std::cout << evalErrorMessages[s1.error] << " / " << evalErrorMessages[s2.error] << std::endl;
+        }
+    }
+
+    // 操作数栈超过一页的表达式不生成本地代码，结果由解释器给出
+    std::string deep = "x";
+    for (int k = 0; k < 1000; k++) {
+        deep = "1+(" + deep + ")";
+    }
+    CompiledExpression deepCompiled(deep, {"x", "y"});
+    JitExpression deepJit(deepCompiled);
+    double deepValue = 0;
+    EvalStatus deepStatus = deepJit.tryEval(xy, deepValue);
+    std::cout << "嵌套 1000 层: " << (deepJit.isNative() ? "[本地代码] " : "[解释执行] ")
+              << (deepStatus.ok() ? std::to_string(deepValue) : evalErrorMessages[deepStatus.error]) << std::endl;
+
+    std::cout << "\n阶乘与 Γ 函数测试：" << std::endl;
+    std::vector<std::string> factorialTests = {
+        "170!/168!",
+        "200!/198!",
+        "1000!/997!",
+        "3!/5!",
+        "100000000000000000!/100000000000000000!",
+        "2.5!",
+        "0.5!^2",
+        "171!",
+        "(-1)!",
+        "5!/(0-2)!",
+        "3!/(-2)!",
+        "(-1)!/3!",
+    };
+    for (const auto& test : factorialTests) {
+        CompiledExpression compiled(test);
+        double value = 0;
+        EvalStatus status = compiled.tryEval(nullptr, value);
+        std::cout << test << " [" << compiled.size() << " 条指令]";
+        if (status.ok()) {
+            std::cout << " = " << value << std::endl;
+        } else {
+            std::cout << " -> 错误: " << evalErrorMessages[status.error]
+                      << " (位置 " << status.offset << ")" << std::endl;
+        }
+    }
+
+    std::cout << "\n批量求值测试：" << std::endl;
+    CompiledExpression batchExpr("ln(x)+y/(x-2)+sqrt(y)", {"x", "y"});
+    std::vector<double> xs = {1, 2, 3, -1, 10, 2.5};
+    std::vector<double> ys = {4, 1, 9, 1, -4, 0};
+    std::vector<double> results(xs.size());
+    std::vector<uint8_t> errorMask(xs.size());
+    std::span<const double> columns[] = {xs, ys};
+    size_t failed = batchExpr.evalBatch(columns, results, errorMask);
+    for (size_t k = 0; k < xs.size(); k++) {
+        std::cout << "x=" << xs[k] << ", y=" << ys[k] << " -> ";
+        if (errorMask[k] == BATCH_OK) {
+            std::cout << results[k] << std::endl;
+        } else {
+            std::cout << "错误标志 " << (int)errorMask[k] << std::endl;
+        }
+    }
+    std::cout << "出错行数: " << failed << std::endl;
+
+    // 编译失败后程序为空，每一行都标记为无效表达式
+    batchExpr.tryAssign("x+");
+    failed = batchExpr.evalBatch(columns, results, errorMask);
+    std::cout << "x+ 编译失败后批量求值: 出错行数 " << failed << ", 错误标志 " << (int)errorMask[0] << std::endl;
+}
+
+// 不抛异常接口测试：输出错误类型与出错位置
+void testErrorCodes() {
+    std::cout << "\n错误码接口测试：" << std::endl;
+    std::vector<std::string> cases = {
+        "2+3*4",
+        "2++3",
+        "(2+3",
+        "2+3)",
+        "sqrt(16)*foo(2)",
+        "1+2/(3-3)",
+        "2+log(0)",
+        "(-3)!",
+        "2#3",
+    };
+
+    for (const auto& test : cases) {
+        EvalResult result = tryEvaluateExtendedExpression(test);
+        if (result.ok()) {
+            std::cout << test << " = " << std::fixed << std::setprecision(6) << result.value << std::endl;
+        } else {
+            std::cout << test << " -> 错误: " << evalErrorMessages[result.error]
+                      << " (位置 " << result.offset << ")" << std::endl;
+            std::cout << std::string(test.length() + 3 + result.offset, ' ') << "^" << std::endl;
+        }
+    }
+}
+
+// 稳态零分配测试：预热后重复求值，统计期间的堆分配次数
+void testZeroAllocation() {
+    std::cout << "\n零分配测试：" << std::endl;
+#ifndef CALC_COUNT_ALLOCATIONS
+    std::cout << "未启用分配计数，用 -DCALC_COUNT_ALLOCATIONS 编译后运行" << std::endl;
+#else
+
+    const std::string basic = "((2+3)*4-5)/2+3!-2^3";
+    const std::string extended = "sqrt(16)*2+abs(-5)-ln(2.718)*cos(60)";
+    CompiledExpression compiled("x*x+2*x*y-sin(y)", {"x", "y"});
+    double values[] = {1.5, 30};
+
+    double sum = evaluateBasicExpression(basic) + evaluateExtendedExpression(extended) +
+                 compiled.eval(values);
+
+    size_t before = heapAllocationCount.load();
+    for (int k = 0; k < 1000; k++) {
+        sum += evaluateBasicExpression(basic);
+        sum += evaluateExtendedExpression(extended);
+        values[0] = k;
+        sum += compiled.eval(values);
+    }
+    size_t allocations = heapAllocationCount.load() - before;
+
+    std::cout << "3000 次求值期间的堆分配次数: " << allocations
+              << (allocations == 0 ? " (通过)" : " (失败)") << " 校验和 " << sum << std::endl;
+#endif
+}
+
+// 同一公式重复求值：字符串解释与编译后求值的耗时对比
+void runBenchmark() {
+    const std::string formula = "sqrt(16)*2+(3+4)*5-2^3/4+sin(30)";
+    const int iterations = 200000;
+
+    std::cout << "\n重复求值性能测试 (" << formula << ", " << iterations << " 次)：" << std::endl;
+
+    // 两个基线：evaluateExtendedExpression 现在每次调用都把字符串重新编译成字节码再执行；
+    // evaluateBasicExpression 是原来逐字符解析的 pri 表求值器，不支持函数，
+    // 用把函数调用换成结果后的同一公式
+    const std::string expandedFormula = "4*2+(3+4)*5-2^3/4+0.5";
+    double sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sum += evaluateExtendedExpression(formula);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double interpreted = std::chrono::duration<double, std::milli>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sum += evaluateBasicExpression(expandedFormula);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double parsed = std::chrono::duration<double, std::milli>(end - start).count();
+
+    CompiledExpression compiled(formula);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sum += compiled.eval();
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double compiledTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::cout << "  evaluateExtendedExpression (每次重新编译): " << std::fixed << std::setprecision(2)
+              << interpreted << " 毫秒" << std::endl;
+    std::cout << "  evaluateBasicExpression (pri 表逐字符解析, " << expandedFormula << "): "
+              << parsed << " 毫秒" << std::endl;
+    std::cout << "  CompiledExpression::eval: " << compiledTime << " 毫秒" << std::endl;
+    std::cout << "  加速比: 相对重新编译 " << interpreted / compiledTime << "x, 相对 pri 表 "
+              << parsed / compiledTime << "x (校验和 " << sum << ")" << std::endl;
+
+    // 非法输入：异常接口与错误码接口的耗时对比
+    const std::string invalid = "sqrt(16)*2+(3+4)*5-2^3/(4-4)+sin(30)";
+    const int invalidIterations = 20000;
+    start = std::chrono::high_resolution_clock::now();
+    int thrown = 0;
+    for (int i = 0; i < invalidIterations; i++) {
+        try {
+            sum += evaluateExtendedExpression(invalid);
+        } catch (const std::exception&) {
+            thrown++;
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double throwing = std::chrono::duration<double, std::micro>(end - start).count() / invalidIterations;
+
+    start = std::chrono::high_resolution_clock::now();
+    int rejected = 0;
+    for (int i = 0; i < invalidIterations; i++) {
+        rejected += !tryEvaluateExtendedExpression(invalid).ok();
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double errorCode = std::chrono::duration<double, std::micro>(end - start).count() / invalidIterations;
+
+    start = std::chrono::high_resolution_clock::now();
+    int validFailures = 0;
+    for (int i = 0; i < invalidIterations; i++) {
+        EvalResult r = tryEvaluateExtendedExpression(formula);
+        validFailures += !r.ok();
+        sum += r.value;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double validCode = std::chrono::duration<double, std::micro>(end - start).count() / invalidIterations;
+
+    std::cout << "  非法输入 (异常):   " << throwing << " 微秒/次 (抛出 " << thrown << " 次)" << std::endl;
+    std::cout << "  非法输入 (错误码): " << errorCode << " 微秒/次 (失败 " << rejected << " 次)" << std::endl;
+    std::cout << "  合法输入 (错误码): " << validCode << " 微秒/次 (失败 " << validFailures << " 次)" << std::endl;
+
+    // 同一公式：pri 表解释器、字节码解释器与本地代码的单次求值耗时
+    const std::string literalFormula = "(2.5+1)*(2.5-2)/(2.5+3)^2-2.5*4+7";
+    CompiledExpression bytecode("(x+1)*(x-2)/(x+3)^2-x*4+7", {"x"});
+    bytecode.optimize();
+    JitExpression jit(bytecode);
+    double xValue[] = {2.5};
+    const int jitIterations = 1000000;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < jitIterations; i++) {
+        sum += evaluateBasicExpression(literalFormula);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double priTable = std::chrono::duration<double, std::nano>(end - start).count() / jitIterations;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < jitIterations; i++) {
+        sum += bytecode.eval(xValue);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double bytecodeTime = std::chrono::duration<double, std::nano>(end - start).count() / jitIterations;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < jitIterations; i++) {
+        sum += jit.eval(xValue);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double nativeTime = std::chrono::duration<double, std::nano>(end - start).count() / jitIterations;
+
+    std::cout << "  pri 表求值 " << literalFormula << ": " << priTable << " 纳秒/次" << std::endl;
+    std::cout << "  字节码解释: " << bytecodeTime << " 纳秒/次" << std::endl;
+    std::cout << "  本地代码" << (jit.isNative() ? "" : "（不可用，已退回解释执行）") << ": "
+              << nativeTime << " 纳秒/次, 结果 " << jit.eval(xValue) << " / "
+              << evaluateBasicExpression(literalFormula) << std::endl;
+
+    // 深层嵌套与超长表达式
+    std::string nested;
+    for (int k = 0; k < 5000; k++) nested += "abs(";
+    nested += "-2";
+    for (int k = 0; k < 5000; k++) nested += ")";
+
+    std::string longExpr = "1";
+    while (longExpr.length() < 100000) longExpr += "+2*3-4/2";
+
+    for (const std::string* text : {&nested, &longExpr}) {
+        start = std::chrono::high_resolution_clock::now();
+        double value = evaluateExtendedExpression(*text);
+        end = std::chrono::high_resolution_clock::now();
+        std::cout << "  " << text->length() << " 字节表达式 = " << value << ", 用时 "
+                  << std::chrono::duration<double, std::micro>(end - start).count() << " 微秒" << std::endl;
+    }
+
+    // 同一公式作用于整列输入：逐行 eval 与列式批量求值对比
+    const size_t rows = 1000000;
+    CompiledExpression columnExpr("x*x+2*x*y-y/3+abs(x-y)", {"x", "y"});
+    std::vector<double> xs(rows), ys(rows), out(rows);
+    std::vector<uint8_t> errors(rows);
+    for (size_t k = 0; k < rows; k++) {
+        xs[k] = (double)(k % 1000) / 7;
+        ys[k] = (double)(k % 333) / 5 - 30;
+    }
+
+    std::cout << "\n列式求值性能测试 (" << rows << " 行)：" << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    double rowSum = 0;
+    for (size_t k = 0; k < rows; k++) {
+        double values[] = {xs[k], ys[k]};
+        rowSum += columnExpr.eval(values);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double perRow = std::chrono::duration<double, std::milli>(end - start).count();
+
+    std::span<const double> columns[] = {xs, ys};
+    start = std::chrono::high_resolution_clock::now();
+    columnExpr.evalBatch(columns, out, errors);
+    end = std::chrono::high_resolution_clock::now();
+    double batched = std::chrono::duration<double, std::milli>(end - start).count();
+
+    double batchSum = 0;
+    for (double v : out) batchSum += v;
+    std::cout << "  逐行 eval:  " << perRow << " 毫秒" << std::endl;
+    std::cout << "  evalBatch:  " << batched << " 毫秒" << std::endl;
+    std::cout << "  加速比: " << perRow / batched << "x (校验和 " << rowSum << " / " << batchSum << ")" << std::endl;
+
+    // 查表阶乘与逐项连乘对比
+    std::cout << "\n阶乘性能测试 (n = 0..170, " << iterations << " 次)：" << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    double loopSum = 0;
+    for (int i = 0; i < iterations; i++) {
+        double product = 1;
+        for (int k = 2; k <= i % 171; k++) product *= k;
+        loopSum += product;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double looped = std::chrono::duration<double, std::milli>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    double tableSum = 0;
+    for (int i = 0; i < iterations; i++) {
+        tableSum += factorial(i % 171);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double tabled = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << "  逐项连乘: " << looped << " 毫秒" << std::endl;
+    std::cout << "  查表:     " << tabled << " 毫秒" << std::endl;
+    std::cout << "  加速比: " << looped / tabled << "x (校验 " << (loopSum == tableSum ? "一致" : "不一致") << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // calculator --bulk [文件]：从文件或标准输入批量求值，每行一个表达式
+    if (argc > 1 && std::strcmp(argv[1], "--bulk") == 0) {
+        if (argc > 2) {
+            std::ifstream file(argv[2]);
+            if (!file) {
+                std::cerr << "无法打开文件: " << argv[2] << std::endl;
+                return 1;
+            }
+            runBulk(file);
+        } else {
+            runBulk(std::cin);
+        }
+        return 0;
+    }
+
+    runTests();
+    testErrorCodes();
+    testZeroAllocation();
+    runBenchmark();
+    
+    std::cout << "\n=== 交互式计算器 ===" << std::endl;
+    std::cout << "输入表达式进行计算（输入'quit'退出）：" << std::endl;
+    
+    std::string input;
+    while (true) {
+        std::cout << "> ";
+        if (!std::getline(std::cin, input)) {
+            break;
+        }
         
         if (input == "quit" || input == "exit") {
             break;